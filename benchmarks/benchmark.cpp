@@ -0,0 +1,435 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <tuple>
+#include "../splay.h"
+#include "../splay_euler_tour.h"
+#include "../splay_string.h"
+#include "../static_splay.h"
+#include "../splay_small.h"
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr int tree_size = 1 << 16;
+constexpr int operations = 1 << 19;
+
+std::vector<int> uniform_accesses(std::mt19937 &gen) {
+    std::uniform_int_distribution<int> distribution(0, tree_size - 1);
+    std::vector<int> accesses(operations);
+    for (auto &x : accesses) {
+        x = distribution(gen);
+    }
+    return accesses;
+}
+
+std::vector<int> zipf_accesses(std::mt19937 &gen) {
+    std::vector<double> weights(tree_size);
+    for (int i = 0; i < tree_size; i++) {
+        weights[i] = 1.0 / (i + 1);
+    }
+    std::discrete_distribution<int> distribution(weights.begin(), weights.end());
+
+    std::vector<int> permutation(tree_size);
+    for (int i = 0; i < tree_size; i++) {
+        permutation[i] = i;
+    }
+    std::shuffle(permutation.begin(), permutation.end(), gen);
+
+    std::vector<int> accesses(operations);
+    for (auto &x : accesses) {
+        x = permutation[distribution(gen)];
+    }
+    return accesses;
+}
+
+std::vector<int> sequential_accesses(std::mt19937 &) {
+    std::vector<int> accesses(operations);
+    for (int i = 0; i < operations; i++) {
+        accesses[i] = i % tree_size;
+    }
+    return accesses;
+}
+
+std::vector<int> working_set_accesses(std::mt19937 &gen) {
+    std::uniform_int_distribution<int> distribution(0, tree_size - 1);
+    std::uniform_int_distribution<int> offset(0, 1023);
+    std::vector<int> accesses(operations);
+
+    int base = 0;
+    for (int i = 0; i < operations; i++) {
+        if (i % 65536 == 0) {
+            base = distribution(gen);
+        }
+        accesses[i] = (base + offset(gen)) % tree_size;
+    }
+    return accesses;
+}
+
+template<class Policy>
+double run(const std::vector<int> &accesses) {
+    std::vector<int> values(tree_size);
+    for (int i = 0; i < tree_size; i++) {
+        values[i] = i;
+    }
+    auto splay = SplayTree<int, std::less<>, int, Policy>::from_sorted(values);
+
+    auto start = clock_type::now();
+    size_t found = 0;
+    for (int x : accesses) {
+        found += splay.contains(x);
+    }
+    auto elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    if (found != accesses.size()) {
+        std::cerr << "unexpected miss" << std::endl;
+    }
+    return accesses.size() / elapsed / 1e6;
+}
+
+// Worst single lookup after a sequential scan leaves the tree path-shaped, with and without rebalancing.
+void run_adversarial(std::mt19937 &gen) {
+    std::vector<int> values(tree_size);
+    for (int i = 0; i < tree_size; i++) {
+        values[i] = i;
+    }
+    std::uniform_int_distribution<int> distribution(0, tree_size - 1);
+
+    std::cout << "\nlatency after a sequential scan in us, " << tree_size << " keys, 4096 random lookups\n"
+              << std::setw(14) << "rebalance" << std::setw(10) << "p99" << std::setw(10) << "p99.9"
+              << std::setw(10) << "max" << "\n";
+
+    std::vector<std::tuple<std::string, double, size_t>> settings = {
+            { "off", 0.0, 0 },
+            { "3 log n", 3.0, tree_size },
+            { "budget 4096", 3.0, 4096 }
+    };
+
+    for (auto &[name, factor, budget] : settings) {
+        auto splay = SplayTree<int>::from_sorted(values);
+        splay.set_rebalance(factor, budget);
+        for (int x : values) {
+            splay.contains(x);
+        }
+
+        std::vector<double> latencies;
+        for (int i = 0; i < 4096; i++) {
+            int x = distribution(gen);
+            auto start = clock_type::now();
+            splay.contains(x);
+            latencies.push_back(std::chrono::duration<double, std::micro>(clock_type::now() - start).count());
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        std::cout << std::setw(14) << name << std::fixed << std::setprecision(2)
+                  << std::setw(10) << latencies[latencies.size() * 99 / 100]
+                  << std::setw(10) << latencies[latencies.size() * 999 / 1000]
+                  << std::setw(10) << latencies.back() << "\n";
+    }
+}
+
+// Per-operation lookup latency with a cap on rotations per operation. After a sequential scan the capped tree
+// stays deep for a long time, so that workload is also run with depth-triggered rebuilds.
+void run_rotation_budget(std::mt19937 &gen) {
+    std::vector<int> values(tree_size);
+    for (int i = 0; i < tree_size; i++) {
+        values[i] = i;
+    }
+
+    std::vector<int> random(tree_size);
+    std::uniform_int_distribution<int> distribution(0, tree_size - 1);
+    for (auto &x : random) {
+        x = distribution(gen);
+    }
+    std::vector<int> scan = values;
+    scan.insert(scan.end(), random.begin(), random.end());
+
+    std::cout << "\nlookup latency with a rotation budget in us, " << tree_size << " keys\n"
+              << std::setw(14) << "workload" << std::setw(20) << "budget" << std::setw(10) << "Mops/s"
+              << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(10) << "max" << "\n";
+
+    std::vector<std::tuple<std::string, size_t, double>> settings = {
+            { "off", 0, 0.0 },
+            { "8", 8, 0.0 },
+            { "32", 32, 0.0 },
+            { "8 + rebalance", 8, 3.0 }
+    };
+
+    for (auto &[workload, accesses] : { std::make_pair("random", random), std::make_pair("scan + random", scan) }) {
+        for (auto &[name, budget, factor] : settings) {
+            auto splay = SplayTree<int>::from_sorted(values);
+            splay.set_rotation_budget(budget);
+            splay.set_rebalance(factor);
+
+            std::vector<double> latencies;
+            latencies.reserve(accesses.size());
+            auto start = clock_type::now();
+            for (int x : accesses) {
+                auto before = clock_type::now();
+                splay.contains(x);
+                latencies.push_back(std::chrono::duration<double, std::micro>(clock_type::now() - before).count());
+            }
+            auto elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+            std::sort(latencies.begin(), latencies.end());
+
+            std::cout << std::setw(14) << workload << std::setw(20) << name << std::fixed << std::setprecision(2)
+                      << std::setw(10) << accesses.size() / elapsed / 1e6
+                      << std::setw(10) << latencies[latencies.size() * 99 / 100]
+                      << std::setw(10) << latencies[latencies.size() * 999 / 1000]
+                      << std::setw(10) << latencies.back() << "\n";
+        }
+    }
+}
+
+// URL-like paths sharing long prefixes: lookups in SplayTree<std::string> against StringSplayTree.
+void run_strings(std::mt19937 &gen) {
+    constexpr int paths = 1 << 14;
+    constexpr int lookups = 1 << 17;
+
+    const std::vector<std::string> segments = { "api", "v1", "v2", "users", "orders", "static", "assets", "img" };
+    std::vector<std::string> keys;
+    for (int i = 0; i < paths; i++) {
+        std::string key = "https://service.example.com";
+        for (int depth = 0; depth < 4; depth++) {
+            key += "/" + segments[gen() % segments.size()];
+        }
+        keys.push_back(key + "/" + std::to_string(i));
+    }
+
+    std::uniform_int_distribution<int> distribution(0, paths - 1);
+    std::vector<std::string> accesses(lookups);
+    for (auto &key : accesses) {
+        key = keys[distribution(gen)];
+    }
+
+    auto measure = [&](auto &tree) {
+        for (auto &key : keys) {
+            tree.insert(key);
+        }
+        size_t found = 0;
+        auto start = clock_type::now();
+        for (auto &key : accesses) {
+            found += tree.contains(key);
+        }
+        auto elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+        if (found != accesses.size()) {
+            std::cerr << "unexpected miss" << std::endl;
+        }
+        return lookups / elapsed / 1e6;
+    };
+
+    SplayTree<std::string> plain;
+    StringSplayTree<> compact;
+    double plain_speed = measure(plain);
+    double compact_speed = measure(compact);
+
+    std::cout << "\nstring lookups in Mops/s, " << paths << " URL paths, " << lookups << " lookups\n"
+              << std::setw(14) << "SplayTree" << std::fixed << std::setprecision(2) << plain_speed << "\n"
+              << std::setw(14) << "StringSplay" << compact_speed << "\n";
+}
+
+// Many short-lived small sets: build, probe and discard one per request.
+void run_small_sets(std::mt19937 &gen) {
+    constexpr int requests = 1 << 14;
+    constexpr int set_size = 64;
+
+    std::vector<int> values(requests * set_size);
+    for (auto &x : values) {
+        x = static_cast<int>(gen() % 1024);
+    }
+
+    auto measure = [&](auto make) {
+        size_t found = 0;
+        auto start = clock_type::now();
+        for (int r = 0; r < requests; r++) {
+            auto set = make();
+            for (int i = 0; i < set_size; i++) {
+                set.insert(values[r * set_size + i]);
+            }
+            for (int i = 0; i < set_size; i++) {
+                found += set.contains(values[r * set_size + (i * 7) % set_size] + i % 2);
+            }
+        }
+        auto elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+        return std::make_pair(found, requests / elapsed / 1e6);
+    };
+
+    auto [dynamic_found, dynamic_speed] = measure([]() { return SplayTree<int>(); });
+    auto [static_found, static_speed] = measure([]() { return StaticSplayTree<int, set_size>(); });
+    auto [small_found, small_speed] = measure([]() { return SmallSplayTree<int, std::less<int>, int, set_size>(); });
+    if (dynamic_found != static_found || dynamic_found != small_found) {
+        std::cerr << "small set mismatch" << std::endl;
+    }
+
+    std::cout << "\nsmall sets in M requests/s, " << set_size << " inserts and lookups per request\n"
+              << std::setw(14) << "SplayTree" << std::fixed << std::setprecision(3) << dynamic_speed << "\n"
+              << std::setw(14) << "StaticSplay" << static_speed << "\n"
+              << std::setw(14) << "SmallSplay" << small_speed << "\n";
+}
+
+// Read-only probe batches against a tree much larger than the last-level cache.
+void run_batch_lookups(std::mt19937 &gen) {
+    constexpr int keys = 1 << 21;
+    constexpr int probes = 1 << 21;
+
+    std::vector<int> values(keys);
+    for (int i = 0; i < keys; i++) {
+        values[i] = 2 * i;
+    }
+    const auto splay = SplayTree<int>::from_sorted(values);
+
+    std::uniform_int_distribution<int> distribution(0, 2 * keys - 1);
+    std::vector<int> batch(probes);
+    for (auto &x : batch) {
+        x = distribution(gen);
+    }
+
+    auto measure = [&](auto &&lookup) {
+        auto start = clock_type::now();
+        size_t found = lookup();
+        auto elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+        return std::make_pair(found, probes / elapsed / 1e6);
+    };
+
+    auto [looped_found, looped_speed] = measure([&]() {
+        size_t found = 0;
+        for (int x : batch) {
+            found += splay.contains(x);
+        }
+        return found;
+    });
+    auto [batched_found, batched_speed] = measure([&]() {
+        auto found = splay.contains_many(batch);
+        return static_cast<size_t>(std::count(found.begin(), found.end(), true));
+    });
+    if (looped_found != batched_found) {
+        std::cerr << "batch lookup mismatch" << std::endl;
+    }
+
+    std::cout << "\nread-only lookups in Mops/s, " << keys << " keys, " << probes << " probes\n"
+              << std::setw(14) << "contains" << std::fixed << std::setprecision(2) << looped_speed << "\n"
+              << std::setw(14) << "contains_many" << batched_speed << "\n";
+}
+
+// Random forest churn: alternating link/cut with a connectivity query after every update.
+void run_connectivity(std::mt19937 &gen) {
+    constexpr int vertices = 1 << 12;
+    constexpr int updates = 1 << 14;
+
+    std::uniform_int_distribution<int> vertex(0, vertices - 1);
+    std::vector<std::pair<int, int>> queries(updates);
+    for (auto &[u, v] : queries) {
+        u = vertex(gen);
+        v = vertex(gen);
+    }
+
+    auto simulate = [&](auto &&link, auto &&cut, auto &&connected) {
+        std::vector<std::pair<int, int>> edges;
+        size_t answers = 0;
+        auto start = clock_type::now();
+        for (int i = 0; i < updates; i++) {
+            auto [u, v] = queries[i];
+            if (i % 3 == 2 && !edges.empty()) {
+                auto [a, b] = edges[u % edges.size()];
+                cut(a, b);
+                edges[u % edges.size()] = edges.back();
+                edges.pop_back();
+            }
+            else if (link(u, v)) {
+                edges.emplace_back(u, v);
+            }
+            answers += connected(v, queries[updates - 1 - i].first);
+        }
+        auto elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+        return std::make_pair(answers, updates / elapsed / 1e6);
+    };
+
+    EulerTourTree<int> forest(vertices);
+    auto [ett_answers, ett_speed] = simulate(
+            [&](int u, int v) { return forest.link(u, v); },
+            [&](int u, int v) { forest.cut(u, v); },
+            [&](int u, int v) { return forest.connected(u, v); });
+
+    std::vector<std::vector<int>> adjacency(vertices);
+    std::vector<int> component(vertices);
+    auto recompute = [&]() {
+        std::fill(component.begin(), component.end(), -1);
+        std::vector<int> queue;
+        for (int s = 0; s < vertices; s++) {
+            if (component[s] != -1) {
+                continue;
+            }
+            component[s] = s;
+            queue = { s };
+            for (size_t i = 0; i < queue.size(); i++) {
+                for (int next : adjacency[queue[i]]) {
+                    if (component[next] == -1) {
+                        component[next] = s;
+                        queue.push_back(next);
+                    }
+                }
+            }
+        }
+    };
+    recompute();
+    auto [bfs_answers, bfs_speed] = simulate(
+            [&](int u, int v) {
+                if (component[u] == component[v]) {
+                    return false;
+                }
+                adjacency[u].push_back(v);
+                adjacency[v].push_back(u);
+                recompute();
+                return true;
+            },
+            [&](int u, int v) {
+                std::erase(adjacency[u], v);
+                std::erase(adjacency[v], u);
+                recompute();
+            },
+            [&](int u, int v) { return component[u] == component[v]; });
+
+    if (ett_answers != bfs_answers) {
+        std::cerr << "connectivity mismatch" << std::endl;
+    }
+    std::cout << "\ndynamic connectivity in Mops/s, " << vertices << " vertices, " << updates << " updates\n"
+              << std::setw(14) << "euler tour" << std::fixed << std::setprecision(4) << ett_speed << "\n"
+              << std::setw(14) << "recompute" << bfs_speed << "\n";
+}
+
+int main() {
+    std::mt19937 gen(2024);
+
+    std::vector<std::pair<std::string, std::function<std::vector<int>(std::mt19937 &)>>> distributions = {
+            { "uniform", uniform_accesses },
+            { "zipf", zipf_accesses },
+            { "sequential", sequential_accesses },
+            { "working set", working_set_accesses }
+    };
+
+    std::cout << "contains() throughput in Mops/s, " << tree_size << " keys, " << operations << " accesses\n";
+    std::cout << std::left << std::setw(14) << "distribution" << std::setw(10) << "full" << std::setw(10) << "semi"
+              << std::setw(10) << "depth>32" << std::setw(10) << "random10%" << "\n";
+
+    for (auto &[name, generate] : distributions) {
+        auto accesses = generate(gen);
+        std::cout << std::setw(14) << name << std::fixed << std::setprecision(2)
+                  << std::setw(10) << run<FullSplay>(accesses)
+                  << std::setw(10) << run<SemiSplay>(accesses)
+                  << std::setw(10) << run<DepthThresholdSplay<32>>(accesses)
+                  << std::setw(10) << run<RandomizedSplay<10>>(accesses) << "\n";
+    }
+
+    run_adversarial(gen);
+    run_rotation_budget(gen);
+    run_connectivity(gen);
+    run_strings(gen);
+    run_small_sets(gen);
+    run_batch_lookups(gen);
+
+    return 0;
+}
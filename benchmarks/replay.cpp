@@ -0,0 +1,188 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <vector>
+#include <set>
+#include <string>
+#include <algorithm>
+#include "../splay.h"
+#include "../splay_trace.h"
+
+using clock_type = std::chrono::steady_clock;
+
+template<class V>
+using trace_t = std::vector<std::pair<TraceOperation, V>>;
+
+void report(const std::string &name, std::vector<double> &latencies, double seconds, double rotations) {
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return latencies.empty() ? 0.0 : latencies[std::min(latencies.size() - 1, size_t(p * latencies.size()))];
+    };
+
+    std::cout << std::left << std::setw(12) << name << std::fixed << std::setprecision(2)
+              << std::setw(12) << latencies.size() / seconds / 1e6
+              << std::setw(14) << rotations
+              << std::setw(10) << percentile(0.5)
+              << std::setw(10) << percentile(0.99)
+              << std::setw(10) << percentile(0.999)
+              << std::setw(10) << (latencies.empty() ? 0.0 : latencies.back()) << "\n";
+}
+
+template<class V>
+void report_statistics(const SplayTree<V> &splay) {
+    std::cout << "\nhottest keys (sampled accesses):";
+    for (auto &[value, count] : splay.hottest(10)) {
+        std::cout << " " << value << ":" << count;
+    }
+
+    std::cout << "\nlookup depth histogram:";
+    auto histogram = splay.depth_histogram();
+    for (size_t depth = 0; depth < histogram.size(); depth++) {
+        std::cout << " " << depth << ":" << histogram[depth];
+    }
+    std::cout << "\n";
+}
+
+template<class V>
+void replay_splay(const trace_t<V> &trace, size_t sample_period) {
+    SplayTree<V> splay;
+    if (sample_period > 0) {
+        splay.enable_statistics(sample_period);
+    }
+    std::vector<double> latencies;
+    latencies.reserve(trace.size());
+
+    auto start = clock_type::now();
+    for (auto &[operation, value] : trace) {
+        auto before = clock_type::now();
+        switch (operation) {
+            case TraceOperation::insert:
+                splay.insert(value);
+                break;
+            case TraceOperation::erase:
+                splay.erase(value);
+                break;
+            case TraceOperation::contains:
+                splay.contains(value);
+                break;
+            case TraceOperation::find:
+                splay.find(value);
+                break;
+            case TraceOperation::lower_bound:
+                splay.lower_bound(value);
+                break;
+            case TraceOperation::upper_bound:
+                splay.upper_bound(value);
+                break;
+            case TraceOperation::erase_less:
+                if (!splay.empty()) {
+                    splay.erase_less(value);
+                }
+                break;
+            case TraceOperation::erase_greater:
+                if (!splay.empty()) {
+                    splay.erase_greater(value);
+                }
+                break;
+        }
+        latencies.push_back(std::chrono::duration<double, std::nano>(clock_type::now() - before).count());
+    }
+    double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    report("SplayTree", latencies, seconds, trace.empty() ? 0.0 : double(splay.rotations()) / trace.size());
+    if (sample_period > 0) {
+        report_statistics(splay);
+    }
+}
+
+template<class V>
+void replay_set(const trace_t<V> &trace) {
+    std::set<V> set;
+    std::vector<double> latencies;
+    latencies.reserve(trace.size());
+
+    auto start = clock_type::now();
+    for (auto &[operation, value] : trace) {
+        auto before = clock_type::now();
+        switch (operation) {
+            case TraceOperation::insert:
+                set.insert(value);
+                break;
+            case TraceOperation::erase:
+                set.erase(value);
+                break;
+            case TraceOperation::contains:
+                (void) set.contains(value);
+                break;
+            case TraceOperation::find:
+                (void) set.find(value);
+                break;
+            case TraceOperation::lower_bound:
+                (void) set.lower_bound(value);
+                break;
+            case TraceOperation::upper_bound:
+                (void) set.upper_bound(value);
+                break;
+            case TraceOperation::erase_less:
+                set.erase(set.begin(), set.lower_bound(value));
+                break;
+            case TraceOperation::erase_greater:
+                set.erase(set.upper_bound(value), set.end());
+                break;
+        }
+        latencies.push_back(std::chrono::duration<double, std::nano>(clock_type::now() - before).count());
+    }
+    double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    report("std::set", latencies, seconds, 0.0);
+}
+
+template<class V>
+void replay(std::istream &in, size_t sample_period) {
+    TraceReader<V> reader(in);
+    trace_t<V> trace;
+    while (auto record = reader.next()) {
+        trace.push_back(*record);
+    }
+
+    std::cout << trace.size() << " operations\n";
+    std::cout << std::left << std::setw(12) << "container" << std::setw(12) << "Mops/s" << std::setw(14) << "rotations/op"
+              << std::setw(10) << "p50 ns" << std::setw(10) << "p99 ns" << std::setw(10) << "p99.9 ns"
+              << std::setw(10) << "max ns" << "\n";
+    replay_set(trace);
+    replay_splay(trace, sample_period);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2 && argc != 3) {
+        std::cerr << "usage: " << argv[0] << " <trace file> [statistics sample period]" << std::endl;
+        return 2;
+    }
+    size_t sample_period = argc == 3 ? std::stoul(argv[2]) : 0;
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) {
+        std::cerr << "cannot open '" << argv[1] << "'" << std::endl;
+        return 1;
+    }
+
+    try {
+        switch (TraceReader<int>::value_size(in)) {
+            case sizeof(std::int32_t):
+                replay<std::int32_t>(in, sample_period);
+                break;
+            case sizeof(std::int64_t):
+                replay<std::int64_t>(in, sample_period);
+                break;
+            default:
+                std::cerr << "only 32- and 64-bit integer traces can be replayed" << std::endl;
+                return 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
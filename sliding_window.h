@@ -0,0 +1,120 @@
+#ifndef SLIDING_WINDOW_H
+#define SLIDING_WINDOW_H
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "splay.h"
+
+// Samples from the last window time units with their aggregate. Samples are kept in a SplayTree ordered by
+// (time, arrival), so late arrivals are placed correctly. Advancing splays the cutoff and detaches everything
+// before it in one step; the detached subtrees are freed in bulk by collect(), or automatically once more than
+// collect_threshold expired samples are waiting.
+template<class T, class FunctionType = T, class Time = std::int64_t>
+class SlidingWindowTree {
+public:
+    using Function = typename SplayTree<T, std::less<T>, FunctionType>::Function;
+
+private:
+    struct Sample {
+        Time time;
+        std::uint64_t sequence;
+        T value;
+    };
+
+    struct SampleLess {
+        bool operator ()(const Sample &sample1, const Sample &sample2) const {
+            return sample1.time < sample2.time
+                   || (!(sample2.time < sample1.time) && sample1.sequence < sample2.sequence);
+        }
+    };
+
+    using tree_t = SplayTree<Sample, SampleLess, FunctionType>;
+
+    Time window;
+    Function function;
+    tree_t samples;
+    std::uint64_t next_sequence = 0;
+
+    bool started = false;
+    Time cutoff{};
+
+    std::vector<tree_t> expired;
+    size_t expired_count = 0;
+    size_t collect_threshold;
+
+    static typename tree_t::Function wrap(const Function &function) {
+        if (!function) {
+            return typename tree_t::Function();
+        }
+        return typename tree_t::Function([function](const Sample &sample, const FunctionType &left,
+                                                    const FunctionType &right) {
+            return function(sample.value, left, right);
+        }, function.get_default());
+    }
+
+public:
+    explicit SlidingWindowTree(Time window, Function function = Function(),
+                               size_t collect_threshold = size_t(1) << 16)
+            : window(window), function(function), samples(wrap(function)), collect_threshold(collect_threshold) {}
+
+    // Adds a sample; samples at or before the current cutoff are already expired and are dropped.
+    bool add(Time time, const T &value) {
+        if (started && !(cutoff < time)) {
+            return false;
+        }
+
+        samples.insert(Sample { time, next_sequence++, value });
+        return true;
+    }
+
+    // Expires every sample at or before now - window. The cutoff never moves back.
+    void advance(Time now) {
+        Time new_cutoff = now - window;
+        if (started && !(cutoff < new_cutoff)) {
+            return;
+        }
+        started = true;
+        cutoff = new_cutoff;
+
+        if (samples.empty()) {
+            return;
+        }
+
+        auto old = samples.erase_less(Sample { cutoff, std::numeric_limits<std::uint64_t>::max(), T() });
+        if (!old.empty()) {
+            expired_count += old.size();
+            expired.push_back(std::move(old));
+        }
+        if (expired_count > collect_threshold) {
+            collect();
+        }
+    }
+
+    // Frees the expired samples.
+    void collect() {
+        expired.clear();
+        expired_count = 0;
+    }
+
+    [[nodiscard]] FunctionType get_function_value() const {
+        return samples.get_function_value();
+    }
+
+    [[nodiscard]] size_t size() const {
+        return samples.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return samples.empty();
+    }
+
+    [[nodiscard]] size_t pending_expired() const {
+        return expired_count;
+    }
+};
+
+#endif // SLIDING_WINDOW_H
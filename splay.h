@@ -1,17 +1,120 @@
+#ifndef SPLAY_H
+#define SPLAY_H
+
 #include <iostream>
 #include <memory>
 #include <stack>
 #include <map>
 #include <functional>
 #include <concepts>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <future>
+#include <thread>
+#include <random>
+#include <cstdint>
+#include <utility>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "splay_concepts.h"
+
+template<class P>
+concept SplayingPolicy = requires(P p, size_t depth) {
+    { p.should_splay(depth) } -> std::same_as<bool>;
+    { P::semi } -> std::convertible_to<bool>;
+};
+
+struct FullSplay {
+    static constexpr bool semi = false;
+
+    bool should_splay(size_t) {
+        return true;
+    }
+};
+
+struct SemiSplay {
+    static constexpr bool semi = true;
+
+    bool should_splay(size_t) {
+        return true;
+    }
+};
+
+template<size_t Threshold>
+struct DepthThresholdSplay {
+    static constexpr bool semi = false;
+
+    bool should_splay(size_t depth) {
+        return depth > Threshold;
+    }
+};
+
+template<unsigned Percent>
+struct RandomizedSplay {
+    static constexpr bool semi = false;
+
+    std::minstd_rand generator;
+
+    bool should_splay(size_t) {
+        return generator() % 100 < Percent;
+    }
+};
+
+// Abbreviated keys map values to integers in an order-preserving way: Comp(x, y) must imply key(x) <= key(y), and
+// equal values must get equal keys. Nodes cache the key of their value and descents compare keys first, calling
+// the comparator only when they are equal, so an abbreviation that does not follow Comp's order gives wrong
+// results. An abbreviation may declare orders_like<C>, checked against the tree's comparator at compile time.
+struct NoAbbreviation {};
+
+template<class A, class C>
+constexpr bool abbreviation_orders_like() {
+    if constexpr (requires { A::template orders_like<C>; }) {
+        return A::template orders_like<C>;
+    }
+    else {
+        return true;
+    }
+}
+
+template<class A, class V>
+concept KeyAbbreviation = std::same_as<A, NoAbbreviation> || requires(A a, const V &x) {
+    { a(x) } -> std::totally_ordered;
+};
+
+// The first 8 bytes of a string, zero-padded, as a big-endian integer. Follows the ascending order of std::less.
+struct StringPrefixKey {
+    template<class C>
+    static constexpr bool orders_like = std::derived_from<C, std::less<>> || std::derived_from<C, std::less<std::string>>
+                                        || std::derived_from<C, std::less<std::string_view>>;
+
+    std::uint64_t operator ()(std::string_view value) const {
+        std::uint64_t key = 0;
+        for (size_t i = 0; i < std::min<size_t>(value.size(), 8); i++) {
+            key |= std::uint64_t(static_cast<unsigned char>(value[i])) << (56 - 8 * i);
+        }
+        return key;
+    }
+};
 
-template<class C, class V>
-concept Comparator = requires(C c, const V &x, const V &y) {
-    { c(x, y) } -> std::same_as<bool>;
+enum class TraceOperation : std::uint8_t {
+    insert, erase, contains, find, lower_bound, upper_bound, erase_less, erase_greater
 };
 
-template<class V, Comparator<V> Comp = std::less<V>, class FunctionType = int>
+template<class V, Comparator<V> Comp = std::less<V>, class FunctionType = int, SplayingPolicy SplayPolicy = FullSplay,
+         KeyAbbreviation<V> Abbreviate = NoAbbreviation>
 class SplayTree {
+    static_assert(abbreviation_orders_like<Abbreviate, Comp>(),
+                  "SplayTree: the key abbreviation does not follow the comparator's order");
+
 public:
     class Function {
         using function_t = std::function<const FunctionType(const V &, const FunctionType &, const FunctionType &)>;
@@ -60,18 +163,48 @@ private:
     using const_node_ptr_t = std::shared_ptr<const Node>;
     using traversal_t = std::stack<const_node_ptr_t>;
 
-    [[nodiscard]] static bool compare(const V &value1, const V &value2) {
-        return Comp{}(value1, value2);
+    [[nodiscard]] bool compare(const V &value1, const V &value2) const {
+        return comp(value1, value2);
+    }
+
+    static constexpr bool abbreviated = !std::same_as<Abbreviate, NoAbbreviation>;
+
+    struct NoKey {};
+
+    using key_t = typename std::conditional_t<abbreviated, std::invoke_result<Abbreviate, const V &>,
+            std::type_identity<NoKey>>::type;
+
+    static key_t abbreviate(const V &value) {
+        if constexpr (abbreviated) {
+            return Abbreviate{}(value);
+        }
+        else {
+            return {};
+        }
+    }
+
+    // Compares value, whose abbreviated key is key, with the value of node: negative, zero or positive.
+    [[nodiscard]] int order(const V &value, const key_t &key, const Node &node) const {
+        if constexpr (abbreviated) {
+            if (key != node.key) {
+                return key < node.key ? -1 : 1;
+            }
+        }
+        return compare(value, node.value) ? -1 : compare(node.value, value) ? 1 : 0;
     }
 
     class Node : public std::enable_shared_from_this<Node> {
+        friend class SplayTree;
+
         using node_ptr_t = std::shared_ptr<Node>;
         using node_weakptr_t = std::weak_ptr<Node>;
 
         node_ptr_t right, left;
         node_weakptr_t parent;
         V value;
+        [[no_unique_address]] key_t key;
         size_t subtree_size = 1;
+        std::uint32_t access_count = 0;
 
         FunctionType function_value;
 
@@ -97,6 +230,7 @@ private:
         }
 
         void rotate_right(const SplayTree &splay_tree) {
+            splay_tree.rotation_count++;
             auto grandparent = get_parent()->get_parent();
             auto current_parent = get_parent();
             auto this_ptr = get_ptr();
@@ -118,6 +252,7 @@ private:
         }
 
         void rotate_left(const SplayTree &splay_tree) {
+            splay_tree.rotation_count++;
             auto grandparent = get_parent()->get_parent();
             auto current_parent = get_parent();
             auto this_ptr = get_ptr();
@@ -179,8 +314,56 @@ private:
             }
         }
 
+        // Splays while the next step fits into budget rotations. Returns whether the node reached the root.
+        bool splay(const SplayTree &splay_tree, size_t &budget) {
+            while (auto parent = get_parent()) {
+                size_t cost = parent->get_parent() == nullptr ? 1 : 2;
+                if (cost > budget) {
+                    return false;
+                }
+                local_splay(splay_tree);
+                budget -= cost;
+            }
+            return true;
+        }
+
+        void rotate_up(const SplayTree &splay_tree) {
+            if (get_parent()->get_left() == get_ptr()) {
+                rotate_right(splay_tree);
+            }
+            else {
+                rotate_left(splay_tree);
+            }
+        }
+
+        // Zig-zig steps rotate only the parent and continue from it, roughly halving the access path.
+        node_ptr_t semi_splay(const SplayTree &splay_tree) {
+            auto node = get_ptr();
+
+            while (node->get_parent() != nullptr) {
+                auto parent = node->get_parent();
+                auto grandparent = parent->get_parent();
+
+                if (grandparent == nullptr) {
+                    node->rotate_up(splay_tree);
+                    break;
+                }
+
+                if ((grandparent->get_left() == parent) == (parent->get_left() == node)) {
+                    parent->rotate_up(splay_tree);
+                    node = parent;
+                }
+                else {
+                    node->rotate_up(splay_tree);
+                    node->rotate_up(splay_tree);
+                }
+            }
+
+            return node;
+        }
+
     public:
-        explicit Node(V _value) : value(_value) {
+        explicit Node(V _value) : value(_value), key(abbreviate(value)) {
             right = nullptr;
             left = nullptr;
             parent = node_weakptr_t();
@@ -228,23 +411,26 @@ private:
 
         void set_value(V _value) {
             value = _value;
+            key = abbreviate(value);
         }
 
-        InternalIterator<true> search_no_splay(V v, const SplayTree &splay_tree, traversal_t &traversal) const {
+        InternalIterator<true> search_no_splay(V v, const key_t &v_key, const SplayTree &splay_tree,
+                                               traversal_t &traversal) const {
             auto this_ptr = get_ptr();
             traversal.push(this_ptr);
 
-            if (compare(v, value)) {
+            int dir = splay_tree.order(v, v_key, *this);
+            if (dir < 0) {
                 if (left != nullptr) {
-                    return left->search_no_splay(v, splay_tree, traversal);
+                    return left->search_no_splay(v, v_key, splay_tree, traversal);
                 }
                 else {
                     return InternalIterator<true>(traversal);
                 }
             }
-            else if (compare(value, v)) {
+            else if (dir > 0) {
                 if (right != nullptr) {
-                    return right->search_no_splay(v, splay_tree, traversal);
+                    return right->search_no_splay(v, v_key, splay_tree, traversal);
                 }
                 else {
                     return InternalIterator<true>(traversal);
@@ -257,7 +443,7 @@ private:
 
         InternalIterator<true> search_no_splay(V v, const SplayTree &splay_tree) const {
             auto traversal = traversal_t();
-            return search_no_splay(v, splay_tree, traversal);
+            return search_no_splay(v, abbreviate(v), splay_tree, traversal);
         }
 
         node_ptr_t search(V v, SplayTree &splay_tree) {
@@ -272,35 +458,33 @@ private:
 
         node_ptr_t insert(node_ptr_t node, SplayTree &splay_tree) {
             auto this_ptr = get_ptr();
-            V v = node->get_value();
+            const V &v = node->value;
 
-            if (compare(v, value)) {
+            int dir = splay_tree.order(v, node->key, *this);
+            if (dir < 0) {
                 if (left != nullptr) {
-                    return left->insert(v, splay_tree);
+                    return left->insert(node, splay_tree);
                 }
                 else {
                     set_left(node, splay_tree);
-                    node->splay(splay_tree);
-                    splay_tree.root = node;
+                    splay_tree.splay_node(node, true);
 
                     return node;
                 }
             }
-            else if (compare(value, v)) {
+            else if (dir > 0) {
                 if (right != nullptr) {
-                    return right->insert(v, splay_tree);
+                    return right->insert(node, splay_tree);
                 }
                 else {
                     set_right(node, splay_tree);
-                    node->splay(splay_tree);
-                    splay_tree.root = node;
+                    splay_tree.splay_node(node, true);
 
                     return node;
                 }
             }
             else {
-                splay(splay_tree);
-                splay_tree.root = get_ptr();
+                splay_tree.splay_node(get_ptr());
                 return get_ptr();
             }
         }
@@ -312,23 +496,21 @@ private:
         node_ptr_t remove(V v, SplayTree &splay_tree) {
             auto this_ptr = get_ptr();
 
-            if (compare(v, value)) {
+            if (splay_tree.compare(v, value)) {
                 if (left != nullptr) {
                     return left->remove(v, splay_tree);
                 }
                 else {
-                    splay(splay_tree);
-                    splay_tree.root = get_ptr();
+                    splay_tree.splay_node(get_ptr());
                     return get_ptr();
                 }
             }
-            else if (compare(value, v)) {
+            else if (splay_tree.compare(value, v)) {
                 if (right != nullptr) {
                     return right->remove(v, splay_tree);
                 }
                 else {
-                    splay(splay_tree);
-                    splay_tree.root = get_ptr();
+                    splay_tree.splay_node(get_ptr());
                     return get_ptr();
                 }
             }
@@ -369,11 +551,16 @@ private:
                     }
 
                     set_value(node->get_value());
+                    access_count = node->access_count;
                     if (node == left) {
                         set_left(node->left, splay_tree);
                     }
                     else {
                         node->get_parent()->set_right(node->left, splay_tree);
+                        for (auto ancestor = node->get_parent()->get_parent(); ancestor != nullptr;
+                             ancestor = ancestor->get_parent()) {
+                            ancestor->update(splay_tree);
+                        }
                     }
 
                     new_root = get_ptr();
@@ -381,14 +568,56 @@ private:
 
 
                 if (new_root != nullptr) {
-                    new_root->splay(splay_tree);
+                    splay_tree.splay_node(new_root, true);
+                }
+                else {
+                    splay_tree.root = nullptr;
                 }
-                splay_tree.root = new_root;
 
                 return new_root;
             }
         }
 
+        static const Node *leftmost(const Node *node) {
+            while (node->left != nullptr) {
+                node = node->left.get();
+            }
+            return node;
+        }
+
+        static const Node *rightmost(const Node *node) {
+            while (node->right != nullptr) {
+                node = node->right.get();
+            }
+            return node;
+        }
+
+        static const Node *predecessor(const Node *node) {
+            if (node->left != nullptr) {
+                return rightmost(node->left.get());
+            }
+
+            const Node *parent = node->parent.lock().get();
+            while (parent != nullptr && parent->left.get() == node) {
+                node = parent;
+                parent = parent->parent.lock().get();
+            }
+            return parent;
+        }
+
+        static const Node *successor(const Node *node) {
+            if (node->right != nullptr) {
+                return leftmost(node->right.get());
+            }
+
+            const Node *parent = node->parent.lock().get();
+            while (parent != nullptr && parent->right.get() == node) {
+                node = parent;
+                parent = parent->parent.lock().get();
+            }
+            return parent;
+        }
+
         void get_next(traversal_t &traversal) const {
             if (right != nullptr) {
                 auto node = right;
@@ -449,6 +678,8 @@ private:
 
     template<bool increasing_direction>
     class InternalIterator {
+        friend class SplayTree;
+
         traversal_t traversal;
 
         void next() {
@@ -523,6 +754,8 @@ private:
 
     template<bool increasing_direction>
     class Iterator {
+        friend class SplayTree;
+
         InternalIterator<increasing_direction> iterator;
 
     public:
@@ -566,6 +799,62 @@ private:
         }
     };
 
+    class RangeIterator {
+        const Node *node = nullptr;
+
+    public:
+        using iterator_concept = std::forward_iterator_tag;
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = V;
+        using pointer = const V *;
+        using reference = const V &;
+
+        RangeIterator() = default;
+
+        explicit RangeIterator(const Node *node) : node(node) {}
+
+        bool operator==(const RangeIterator &other) const {
+            return node == other.node;
+        }
+
+        reference operator*() const {
+            return node->value;
+        }
+
+        pointer operator->() const {
+            return &node->value;
+        }
+
+        RangeIterator &operator++() {
+            node = Node::successor(node);
+            return *this;
+        }
+
+        RangeIterator operator++(int) {
+            RangeIterator temp = *this;
+            node = Node::successor(node);
+            return temp;
+        }
+    };
+
+    class Range : public std::ranges::view_interface<Range> {
+        RangeIterator first, last;
+
+    public:
+        Range() = default;
+
+        Range(const Node *first, const Node *last) : first(first), last(last) {}
+
+        RangeIterator begin() const {
+            return first;
+        }
+
+        RangeIterator end() const {
+            return last;
+        }
+    };
+
     InternalIterator<true> internal_begin() const {
         return InternalIterator<true>(this);
     }
@@ -590,173 +879,1123 @@ private:
         return root->search_no_splay(v, *this);
     }
 
-    auto _insert(V v) {
-        return root->insert(v, *this);
-    }
+    Iterator<true> iterator_at(const Node *node) const {
+        if (node == nullptr) {
+            return end();
+        }
 
-    auto _remove(V v) {
-        return root->remove(v, *this);
+        std::vector<const_node_ptr_t> ancestors;
+        auto current = node->get_ptr();
+        for (auto parent = current->parent.lock(); parent != nullptr; parent = parent->parent.lock()) {
+            if (parent->left == current) {
+                ancestors.push_back(parent);
+            }
+            current = parent;
+        }
+
+        traversal_t traversal;
+        for (auto it = ancestors.rbegin(); it != ancestors.rend(); it++) {
+            traversal.push(*it);
+        }
+        traversal.push(node->get_ptr());
+
+        return Iterator<true>(traversal);
     }
 
-    explicit SplayTree(node_ptr_t root) : root(root) {}
+    const Node *bound_no_splay(const V &value, bool strict) const {
+        const Node *node = root.get();
+        const Node *result = nullptr;
+        key_t key = abbreviate(value);
 
-    explicit SplayTree(node_ptr_t root, Function function) : root(root), function(function) {}
+        while (node != nullptr) {
+            int dir = order(value, key, *node);
+            if (strict ? dir < 0 : dir <= 0) {
+                result = node;
+                node = node->left.get();
+            }
+            else {
+                node = node->right.get();
+            }
+        }
 
-    Function function;
+        return result;
+    }
 
-public:
+    static constexpr size_t search_group = 16;
 
-    SplayTree() {
-        root = nullptr;
+    static void prefetch(const void *address) {
+#if defined(__GNUC__)
+        __builtin_prefetch(address);
+#endif
     }
 
-    SplayTree(std::initializer_list<V> values) {
-        for (V value : values) {
-            insert(value);
+    // Runs non-splaying searches for all values, search_group of them interleaved at a time: each round moves
+    // every search one level down and prefetches its next node, so their cache misses overlap. Calls
+    // found(i, node) with the node equal to values[i], or nullptr, in order of completion.
+    template<class F>
+    void search_many(const std::vector<V> &values, F found) const {
+        struct Search {
+            size_t index;
+            const Node *node;
+            [[no_unique_address]] key_t key;
+        };
+        std::array<Search, search_group> searches;
+        size_t active = 0, next = 0;
+        for (; active < search_group && next < values.size(); active++, next++) {
+            searches[active] = { next, root.get(), abbreviate(values[next]) };
+        }
+
+        while (active > 0) {
+            for (size_t i = 0; i < active;) {
+                auto &[index, node, key] = searches[i];
+                if (node != nullptr) {
+                    int dir = order(values[index], key, *node);
+                    if (dir != 0) {
+                        node = (dir < 0 ? node->left : node->right).get();
+                        prefetch(node);
+                        i++;
+                        continue;
+                    }
+                }
+
+                found(index, node);
+                if (next < values.size()) {
+                    searches[i++] = { next, root.get(), abbreviate(values[next]) };
+                    next++;
+                }
+                else {
+                    searches[i] = searches[--active];
+                }
+            }
         }
     }
 
-    explicit constexpr SplayTree( Function function) : function(function) {}
+    // Finds the node where a search for value ends and splays it according to the splay policy.
+    node_ptr_t _access(const V &value) {
+        Node *node = root.get();
+        size_t depth = 0;
+        key_t key = abbreviate(value);
+
+        while (true) {
+            int dir = order(value, key, *node);
+            Node *next = dir < 0 ? node->left.get() : dir > 0 ? node->right.get() : nullptr;
+            if (next == nullptr) {
+                break;
+            }
+            node = next;
+            depth++;
+        }
+
+        auto result = node->get_ptr();
+        record_access(node, depth);
+        if (rebalance_factor > 0 && frozen_shape == nullptr && depth > rebalance_limit(size())
+            && rebuild_scapegoat(node)) {
+            depth = 0;
+            for (Node *ancestor = node->parent.lock().get(); ancestor != nullptr;
+                 ancestor = ancestor->parent.lock().get()) {
+                depth++;
+            }
+        }
+        splay_at_depth(result, depth);
 
-    SplayTree(std::initializer_list<V> values,
-                        Function function) : SplayTree(function) {
-        insert(values);
+        return result;
     }
 
-    Iterator<true> begin() const {
-        return Iterator<true>(internal_begin());
+    [[nodiscard]] double rebalance_limit(size_t subtree_size) const {
+        return rebalance_factor * std::log2(static_cast<double>(subtree_size) + 1);
     }
 
-    Iterator<true> end() const {
-        return Iterator<true>(internal_end());
-    }
+    // Rebuilds the highest ancestor of node that is too deep for its size and within the rebuild budget.
+    bool rebuild_scapegoat(Node *node) {
+        Node *scapegoat = nullptr;
+        size_t height = 0;
+        for (Node *ancestor = node; ancestor != nullptr; ancestor = ancestor->parent.lock().get(), height++) {
+            if (ancestor->subtree_size > rebalance_budget) {
+                break;
+            }
+            if (height > rebalance_limit(ancestor->subtree_size)) {
+                scapegoat = ancestor;
+            }
+        }
 
-    Iterator<false> rbegin() const {
-        return Iterator<false>(internal_rbegin());
+        if (scapegoat == nullptr) {
+            return false;
+        }
+        rebuild(scapegoat->get_ptr());
+        return true;
     }
 
-    Iterator<false> rend() const {
-        return Iterator<false>(internal_rend());
-    }
+    // Relinks the subtree into balanced shape in place; values and function values are unchanged.
+    void rebuild(node_ptr_t subtree) {
+        std::vector<node_ptr_t> nodes;
+        nodes.reserve(subtree->subtree_size);
+        for_each_node(subtree.get(), [&](Node &node) { nodes.push_back(node.get_ptr()); });
 
-    Iterator<true> insert(const V &value) {
-        if (root == nullptr) {
-            root = std::make_shared<Node>(value);
+        auto parent = subtree->get_parent();
+        bool is_left = parent != nullptr && parent->left == subtree;
+        auto rebuilt = link_balanced(nodes, 0, nodes.size(), *this);
+
+        if (parent == nullptr) {
+            root = rebuilt;
+            root->remove_parent();
+        }
+        else if (is_left) {
+            parent->set_left(rebuilt, *this);
         }
         else {
-            root->insert(value, *this);
+            parent->set_right(rebuilt, *this);
         }
-
-        return Iterator<true>(traversal_t({ root }));
+        rebalance_count++;
+        pending_splay.reset();
+        frozen_shape = nullptr;
     }
 
-    void insert(std::initializer_list<V> values) {
-        for (auto value : values) {
-            insert(value);
+    void splay_at_depth(const node_ptr_t &node, size_t depth) {
+        if (frozen_shape != nullptr) {
+            if (!frozen_shape->drifted(depth)) {
+                return;
+            }
+            frozen_shape = nullptr;
+        }
+        if (depth > 0 && splay_policy.should_splay(depth)) {
+            if constexpr (SplayPolicy::semi) {
+                root = node->semi_splay(*this);
+            }
+            else {
+                splay_node(node);
+            }
         }
     }
 
-    bool contains(const V &value) {
-        if (root == nullptr) {
-            return false;
+    // Splays node to the root. With a rotation budget only as many steps as fit are done; an unfinished splay
+    // is kept pending and continued with whatever budget later operations have left.
+    void splay_node(const node_ptr_t &node, bool relinked = false) {
+        if (rotation_budget == 0) {
+            node->splay(*this);
+            root = node;
+            return;
+        }
+
+        size_t budget = rotation_budget;
+        if (!advance_splay(node, budget)) {
+            // Rotations keep subtree data right below the stopping point; after an insert or erase relinked
+            // node's path, the ancestors above it still need to be updated.
+            for (auto ancestor = relinked ? node->get_parent() : nullptr; ancestor != nullptr;
+                 ancestor = ancestor->get_parent()) {
+                ancestor->update(*this);
+            }
+            pending_splay = node;
+            return;
         }
 
-        _search(value);
-        V found = root->get_value();
+        auto pending = pending_splay.lock();
+        if (pending == nullptr || pending == node || advance_splay(pending, budget)) {
+            pending_splay.reset();
+        }
+    }
 
-        return !compare(found, value) && !compare(value, found);
+    bool advance_splay(const node_ptr_t &node, size_t &budget) {
+        bool finished = node->splay(*this, budget);
+        if (finished) {
+            root = node;
+        }
+        return finished;
     }
 
-    bool contains(const V &value) const {
+    const Node *splay_bound(const V &value, bool strict) {
         if (root == nullptr) {
-            return false;
+            return nullptr;
         }
 
-        auto node = _search_no_splay(value);
-        V found = node->get_value();
-
-        return !compare(found, value) && !compare(value, found);
-    }
-
-    [[nodiscard]] size_t size() const {
-        return Node::get_subtree_size(root);
+        auto node = _access(value);
+        if (strict ? compare(value, node->value) : !compare(node->value, value)) {
+            return node.get();
+        }
+        return Node::successor(node.get());
     }
 
-    bool erase(const V &value) {
-        if (!contains(value)) {
-            return false;
+    const Node *splay_reverse_bound(const V &value, bool strict) {
+        if (root == nullptr) {
+            return nullptr;
         }
 
-        _remove(value);
-        return true;
+        auto node = _access(value);
+        if (strict ? compare(node->value, value) : !compare(value, node->value)) {
+            return node.get();
+        }
+        return Node::predecessor(node.get());
     }
 
-    Iterator<true> erase(const Iterator<true> &pos) {
-        if (pos == end()) {
-            return end();
-        }
+    static std::optional<V> optional_value(const Node *node) {
+        return node == nullptr ? std::nullopt : std::optional<V>(node->value);
+    }
 
-        auto value = *pos;
+    // Unlinks the root from the tree, joining its subtrees in its place, and returns it as a single node.
+    node_ptr_t detach_root() {
+        pending_splay.reset();
+        auto node = root;
+        auto left = node->unpin_left_subtree(*this);
+        auto right = node->unpin_right_subtree(*this);
 
-        if (erase(value)) {
-            auto it = Iterator<true>(traversal_t({ root }));
-            if (compare(*it, value)) {
-                it++;
-            }
-            return it;
+        if (left == nullptr) {
+            root = right;
         }
         else {
-            return end();
+            auto last = left;
+            while (last->right != nullptr) {
+                last = last->right;
+            }
+            last->splay(*this);
+            last->set_right(right, *this);
+            root = last;
         }
-    }
 
-    SplayTree erase_less(const V &value) {
-        _search(value);
-        auto result = SplayTree(root->unpin_left_subtree(*this), function);
+        return node;
+    }
 
-        auto v = root->get_value();
-        if (compare(v, value)) {
-            erase(v);
-            result.insert(v);
-        }
+    auto _insert(V v) {
+        return root->insert(v, *this);
+    }
 
-        return result;
+    auto _remove(V v) {
+        pending_splay.reset();
+        return root->remove(v, *this);
     }
 
-    SplayTree erase_greater(const V &value) {
-        _search(value);
-        auto result = SplayTree(root->unpin_right_subtree(*this), function);
+    explicit SplayTree(node_ptr_t root) : root(root) {}
 
-        auto v = root->get_value();
-        if (compare(value, v)) {
-            erase(v);
-            result.insert(v);
-        }
+    explicit SplayTree(node_ptr_t root, Function function, Comp comp)
+            : root(root), function(function), comp(comp) {}
 
-        return result;
-    }
+    Function function;
 
-    void clear() {
-        root = nullptr;
-    }
+    Comp comp{};
 
-    [[nodiscard]] bool empty() const {
-        return root == nullptr;
-    }
+    SplayPolicy splay_policy;
 
-    void merge(SplayTree &other) {
-        for (auto x : other) {
-            if (!contains(x)) {
-                insert(x);
-                other.erase(x);
-            }
-        }
+    std::function<void(TraceOperation, const V &)> trace_hook;
+
+    mutable size_t rotation_count = 0;
+
+    // Sampled access counters: on average one in every sample_period accesses bumps the counter of the
+    // accessed node and, for lookups, the histogram bucket of its depth. The gaps between samples are random
+    // so that periodic workloads are not aliased. Disabled unless enable_statistics() is called.
+    struct AccessStatistics {
+        static constexpr size_t max_depth = 64;
+
+        size_t sample_period;
+        size_t countdown = 1;
+        size_t samples = 0;
+        std::array<size_t, max_depth> depths{};
+        std::minstd_rand generator;
+
+        explicit AccessStatistics(size_t sample_period) : sample_period(std::max<size_t>(sample_period, 1)) {}
+
+        bool sample() {
+            if (--countdown != 0) {
+                return false;
+            }
+            countdown = sample_period == 1 ? 1 : 1 + generator() % (2 * sample_period - 1);
+            samples++;
+            return true;
+        }
+    };
+
+    std::unique_ptr<AccessStatistics> statistics;
+
+    size_t rotation_budget = 0;
+    std::weak_ptr<Node> pending_splay;
+
+    double rebalance_factor = 0;
+    size_t rebalance_budget = 0;
+    size_t rebalance_count = 0;
+
+    // Set while splaying is frozen after reshape(). Lookups leave the tree as it is and only add up their
+    // depths; splaying resumes once the average over a window exceeds the depth expected from the weights by
+    // more than the drift factor (plus one level of slack for small expected depths).
+    struct FrozenShape {
+        double expected_depth;
+        double drift;
+        size_t window;
+        size_t accesses = 0;
+        size_t depth_sum = 0;
+
+        FrozenShape(double expected_depth, double drift, size_t window)
+                : expected_depth(expected_depth), drift(drift), window(window) {}
+
+        bool drifted(size_t depth) {
+            depth_sum += depth;
+            if (++accesses < window) {
+                return false;
+            }
+
+            bool result = static_cast<double>(depth_sum) / static_cast<double>(accesses)
+                          > expected_depth * (1 + drift) + 1;
+            accesses = depth_sum = 0;
+            return result;
+        }
+    };
+
+    std::unique_ptr<FrozenShape> frozen_shape;
+
+    void record_access(Node *node, std::optional<size_t> depth = std::nullopt) {
+        if (statistics != nullptr && statistics->sample()) {
+            node->access_count++;
+            if (depth) {
+                statistics->depths[std::min(*depth, AccessStatistics::max_depth - 1)]++;
+            }
+        }
     }
 
-    Iterator<true> find(const V &value) {
+    void trace(TraceOperation operation, const V &value) const {
+        if (trace_hook) {
+            trace_hook(operation, value);
+        }
+    }
+
+    bool _contains(const V &value) {
+        if (root == nullptr) {
+            return false;
+        }
+
+        auto node = _access(value);
+        return !compare(node->value, value) && !compare(value, node->value);
+    }
+
+    // Detaches every node and sorts it into matching or not matching pred, both in order.
+    template<class Pred>
+    void split_nodes(Pred &pred, std::vector<node_ptr_t> &rest, std::vector<node_ptr_t> &matching) {
+        pending_splay.reset();
+        for_each_node([&](Node &node) {
+            (pred(std::as_const(node.value)) ? matching : rest).push_back(node.get_ptr());
+        });
+        root = nullptr;
+    }
+
+    template<class Pred>
+    size_t _erase_if(Pred &pred) {
+        std::vector<node_ptr_t> kept, erased;
+        split_nodes(pred, kept, erased);
+
+        root = link_balanced(kept, 0, kept.size(), *this);
+        if (root != nullptr) {
+            root->remove_parent();
+        }
+        // Unlinked first so that dropping the erased nodes does not recurse through their subtrees.
+        for (auto &node : erased) {
+            node->left = node->right = nullptr;
+        }
+
+        return erased.size();
+    }
+
+    bool _contains_no_splay(const V &value) const {
+        const Node *node = bound_no_splay(value, false);
+        return node != nullptr && !compare(value, node->value);
+    }
+
+    template<class F>
+    void for_each_node(F f) const {
+        for_each_node(root.get(), f);
+    }
+
+    template<class F>
+    static void for_each_node(Node *node, F f) {
+        std::vector<Node *> stack;
+
+        while (node != nullptr || !stack.empty()) {
+            while (node != nullptr) {
+                stack.push_back(node);
+                node = node->left.get();
+            }
+
+            node = stack.back();
+            stack.pop_back();
+            Node *next = node->right.get();
+            f(*node);
+            node = next;
+        }
+    }
+
+    std::vector<const V *> sorted_values() const {
+        std::vector<const V *> values;
+        values.reserve(size());
+        for_each_node([&](const Node &node) { values.push_back(&node.value); });
+
+        return values;
+    }
+
+    static constexpr size_t parallel_grain = 1 << 14;
+
+    static size_t thread_count(size_t threads) {
+        return std::max<size_t>(threads, 1);
+    }
+
+    static node_ptr_t link_balanced(const std::vector<node_ptr_t> &nodes, size_t begin, size_t end,
+                                    const SplayTree &splay_tree, size_t threads = 1) {
+        if (begin == end) {
+            return nullptr;
+        }
+
+        size_t middle = begin + (end - begin) / 2;
+        auto node = nodes[middle];
+
+        node_ptr_t left, right;
+        if (threads > 1 && end - begin > parallel_grain) {
+            auto left_future = std::async(std::launch::async, [&]() {
+                return link_balanced(nodes, begin, middle, splay_tree, threads / 2);
+            });
+            right = link_balanced(nodes, middle + 1, end, splay_tree, threads - threads / 2);
+            left = left_future.get();
+        }
+        else {
+            left = link_balanced(nodes, begin, middle, splay_tree);
+            right = link_balanced(nodes, middle + 1, end, splay_tree);
+        }
+
+        node->set_left(left, splay_tree);
+        node->set_right(right, splay_tree);
+
+        return node;
+    }
+
+    // Links nodes[begin, end) so that every root is the node whose weight interval contains the midpoint of
+    // its range; prefix[i] is the total weight of the first i nodes. Each level at least halves the weight of
+    // the range, and the weight times the depth of every node is added to cost.
+    static node_ptr_t link_weighted(const std::vector<node_ptr_t> &nodes, const std::vector<double> &prefix,
+                                    size_t begin, size_t end, size_t depth, double &cost,
+                                    const SplayTree &splay_tree) {
+        if (begin == end) {
+            return nullptr;
+        }
+
+        double half = (prefix[begin] + prefix[end]) / 2;
+        auto found = std::lower_bound(prefix.begin() + static_cast<std::ptrdiff_t>(begin + 1),
+                                      prefix.begin() + static_cast<std::ptrdiff_t>(end), half);
+        size_t middle = static_cast<size_t>(found - prefix.begin()) - 1;
+        cost += (prefix[middle + 1] - prefix[middle]) * static_cast<double>(depth);
+
+        auto node = nodes[middle];
+        node->set_left(link_weighted(nodes, prefix, begin, middle, depth + 1, cost, splay_tree), splay_tree);
+        node->set_right(link_weighted(nodes, prefix, middle + 1, end, depth + 1, cost, splay_tree), splay_tree);
+
+        return node;
+    }
+
+    template<class Weight>
+    void reshape_nodes(Weight weight, std::optional<double> drift) {
+        frozen_shape = nullptr;
+        if (root == nullptr) {
+            return;
+        }
+
+        std::vector<node_ptr_t> nodes;
+        std::vector<double> weights;
+        nodes.reserve(size());
+        weights.reserve(size());
+        for_each_node([&](Node &node) {
+            nodes.push_back(node.get_ptr());
+            weights.push_back(std::max(0.0, static_cast<double>(weight(std::as_const(node)))));
+        });
+
+        // Every node gets at least a quarter of the average weight, which keeps the depth within O(log n).
+        double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+        double minimum = total > 0 ? total / (4.0 * static_cast<double>(nodes.size())) : 1.0;
+        std::vector<double> prefix(nodes.size() + 1);
+        for (size_t i = 0; i < nodes.size(); i++) {
+            prefix[i + 1] = prefix[i] + weights[i] + minimum;
+        }
+
+        double cost = 0;
+        root = link_weighted(nodes, prefix, 0, nodes.size(), 0, cost, *this);
+        root->remove_parent();
+        pending_splay.reset();
+
+        if (drift) {
+            frozen_shape = std::make_unique<FrozenShape>(cost / prefix.back(), *drift,
+                                                         std::max<size_t>(nodes.size(), 256));
+        }
+    }
+
+    // Destroys the nodes owned only by this subtree iteratively, so deep trees cannot overflow the stack
+    // through the recursive shared_ptr destructor chain. Nodes still shared elsewhere are left intact.
+    static void release(node_ptr_t node) {
+        std::vector<node_ptr_t> stack;
+        if (node != nullptr && node.use_count() == 1) {
+            stack.push_back(std::move(node));
+        }
+
+        while (!stack.empty()) {
+            auto current = std::move(stack.back());
+            stack.pop_back();
+
+            for (auto child : { &current->left, &current->right }) {
+                if (*child != nullptr && child->use_count() == 1) {
+                    stack.push_back(std::move(*child));
+                }
+            }
+        }
+    }
+
+    const Node *select_node(size_t rank) const {
+        const Node *node = root.get();
+
+        while (node != nullptr) {
+            size_t left_size = Node::get_subtree_size(node->left);
+            if (rank < left_size) {
+                node = node->left.get();
+            }
+            else if (rank == left_size) {
+                return node;
+            }
+            else {
+                rank -= left_size + 1;
+                node = node->right.get();
+            }
+        }
+
+        return nullptr;
+    }
+
+    // Calls f(chunk, first node, length) for consecutive in-order chunks, one thread per chunk.
+    template<class F>
+    void for_each_chunk(size_t threads, F f) const {
+        size_t n = size();
+        size_t chunks = std::min(thread_count(threads), std::max<size_t>(n / parallel_grain, 1));
+
+        std::vector<std::future<void>> futures;
+        for (size_t chunk = 0; chunk < chunks; chunk++) {
+            size_t begin = n * chunk / chunks;
+            size_t end = n * (chunk + 1) / chunks;
+            if (begin == end) {
+                continue;
+            }
+
+            auto task = [this, &f, chunk, begin, end]() { f(chunk, select_node(begin), end - begin); };
+            if (chunk + 1 == chunks) {
+                task();
+            }
+            else {
+                futures.push_back(std::async(std::launch::async, task));
+            }
+        }
+
+        for (auto &future : futures) {
+            future.get();
+        }
+    }
+
+    static void recompute_subtree(Node *node, const SplayTree &splay_tree, size_t threads) {
+        if (node == nullptr) {
+            return;
+        }
+
+        if (threads > 1 && node->subtree_size > parallel_grain) {
+            auto left_future = std::async(std::launch::async, [&]() {
+                recompute_subtree(node->left.get(), splay_tree, threads / 2);
+            });
+            recompute_subtree(node->right.get(), splay_tree, threads - threads / 2);
+            left_future.get();
+            node->update(splay_tree);
+            return;
+        }
+
+        std::vector<Node *> order;
+        std::vector<Node *> stack = { node };
+        while (!stack.empty()) {
+            Node *current = stack.back();
+            stack.pop_back();
+            order.push_back(current);
+            for (auto child : { current->left.get(), current->right.get() }) {
+                if (child != nullptr) {
+                    stack.push_back(child);
+                }
+            }
+        }
+
+        for (auto it = order.rbegin(); it != order.rend(); it++) {
+            (*it)->update(splay_tree);
+        }
+    }
+
+    static SplayTree from_sorted_nodes(const std::vector<node_ptr_t> &nodes, Function function, Comp comp,
+                                       size_t threads = 1) {
+        auto result = SplayTree(nullptr, function, comp);
+        result.root = link_balanced(nodes, 0, nodes.size(), result, threads);
+        if (result.root != nullptr) {
+            result.root->remove_parent();
+        }
+
+        return result;
+    }
+
+    template<class Operation>
+    SplayTree set_operation(const SplayTree &other, Operation operation) const {
+        auto first = sorted_values();
+        auto second = other.sorted_values();
+
+        std::vector<const V *> values;
+        values.reserve(first.size() + second.size());
+        operation(first.begin(), first.end(), second.begin(), second.end(), std::back_inserter(values),
+                  [this](const V *value1, const V *value2) { return compare(*value1, *value2); });
+
+        std::vector<node_ptr_t> nodes;
+        nodes.reserve(values.size());
+        for (auto value : values) {
+            nodes.push_back(std::make_shared<Node>(*value));
+        }
+
+        return from_sorted_nodes(nodes, function, comp);
+    }
+
+public:
+    // Owning handle to a node extracted from a tree; it can be inserted into another tree without allocating.
+    class node_type {
+        friend class SplayTree;
+
+        node_ptr_t node;
+
+        explicit node_type(node_ptr_t node) : node(std::move(node)) {}
+
+    public:
+        node_type() = default;
+
+        node_type(node_type &&) noexcept = default;
+
+        node_type &operator =(node_type &&) noexcept = default;
+
+        [[nodiscard]] bool empty() const {
+            return node == nullptr;
+        }
+
+        explicit operator bool() const {
+            return node != nullptr;
+        }
+
+        V &value() const {
+            return node->value;
+        }
+    };
+
+    struct insert_return_type {
+        Iterator<true> position;
+        bool inserted;
+        node_type node;
+    };
+
+    SplayTree() {
+        root = nullptr;
+    }
+
+    SplayTree(std::initializer_list<V> values) {
+        for (V value : values) {
+            insert(value);
+        }
+    }
+
+    explicit constexpr SplayTree( Function function) : function(function) {}
+
+    // Orders values with the given comparator instance instead of a default-constructed one.
+    explicit SplayTree(Comp comp, Function function = Function()) : function(function), comp(comp) {}
+
+    SplayTree(std::initializer_list<V> values,
+                        Function function) : SplayTree(function) {
+        insert(values);
+    }
+
+    Iterator<true> begin() const {
+        return Iterator<true>(internal_begin());
+    }
+
+    Iterator<true> end() const {
+        return Iterator<true>(internal_end());
+    }
+
+    Iterator<false> rbegin() const {
+        return Iterator<false>(internal_rbegin());
+    }
+
+    Iterator<false> rend() const {
+        return Iterator<false>(internal_rend());
+    }
+
+    Iterator<true> insert(const V &value) {
+        trace(TraceOperation::insert, value);
+        node_ptr_t node;
+        if (root == nullptr) {
+            root = node = std::make_shared<Node>(value);
+            root->update(*this);
+        }
+        else {
+            node = root->insert(value, *this);
+        }
+        record_access(node.get());
+
+        return iterator_at(node.get());
+    }
+
+    // Links the node of handle into the tree. If an equal value is present, the handle is returned unchanged.
+    insert_return_type insert(node_type &&handle) {
+        if (handle.empty()) {
+            return { end(), false, node_type() };
+        }
+
+        auto node = std::move(handle.node);
+        trace(TraceOperation::insert, node->value);
+        if (root == nullptr) {
+            root = node;
+            node->update(*this);
+        }
+        else if (auto found = root->insert(node, *this); found != node) {
+            return { iterator_at(found.get()), false, node_type(std::move(node)) };
+        }
+
+        return { iterator_at(node.get()), true, node_type() };
+    }
+
+    void insert(std::initializer_list<V> values) {
+        for (auto value : values) {
+            insert(value);
+        }
+    }
+
+    bool contains(const V &value) {
+        trace(TraceOperation::contains, value);
+        return _contains(value);
+    }
+
+    bool contains(const V &value) const {
+        trace(TraceOperation::contains, value);
+        if (root == nullptr) {
+            return false;
+        }
+
+        auto node = _search_no_splay(value);
+        V found = node->get_value();
+
+        return !compare(found, value) && !compare(value, found);
+    }
+
+    // Membership of every value, without splaying; meant for large read-only batches. See search_many().
+    std::vector<bool> contains_many(const std::vector<V> &values) const {
+        std::vector<bool> result(values.size());
+        for (auto &value : values) {
+            trace(TraceOperation::contains, value);
+        }
+        search_many(values, [&](size_t i, const Node *node) { result[i] = node != nullptr; });
+
+        return result;
+    }
+
+    std::vector<Iterator<true>> find_many(const std::vector<V> &values) const {
+        std::vector<const Node *> nodes(values.size());
+        for (auto &value : values) {
+            trace(TraceOperation::find, value);
+        }
+        search_many(values, [&](size_t i, const Node *node) { nodes[i] = node; });
+
+        std::vector<Iterator<true>> result;
+        result.reserve(values.size());
+        for (auto node : nodes) {
+            result.push_back(iterator_at(node));
+        }
+
+        return result;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return Node::get_subtree_size(root);
+    }
+
+    bool erase(const V &value) {
+        trace(TraceOperation::erase, value);
+        // With a rotation budget the check must not splay, so that the removal gets the whole budget.
+        if (rotation_budget > 0 ? !_contains_no_splay(value) : !_contains(value)) {
+            return false;
+        }
+
+        _remove(value);
+        return true;
+    }
+
+    Iterator<true> erase(const Iterator<true> &pos) {
+        if (pos == end()) {
+            return end();
+        }
+
+        auto value = *pos;
+
+        if (erase(value)) {
+            return iterator_at(bound_no_splay(value, true));
+        }
+        else {
+            return end();
+        }
+    }
+
+    node_type extract(const V &value) {
+        trace(TraceOperation::erase, value);
+        if (root == nullptr) {
+            return node_type();
+        }
+
+        auto node = _access(value);
+        if (compare(node->value, value) || compare(value, node->value)) {
+            return node_type();
+        }
+        node->splay(*this);
+        root = node;
+
+        return node_type(detach_root());
+    }
+
+    node_type extract(const Iterator<true> &pos) {
+        if (pos == end()) {
+            return node_type();
+        }
+
+        auto node = std::const_pointer_cast<Node>(pos.iterator.traversal.top());
+        trace(TraceOperation::erase, node->value);
+        node->splay(*this);
+        root = node;
+
+        return node_type(detach_root());
+    }
+
+    // Keeps the k smallest values and returns a tree with the rest.
+    SplayTree split_at_rank(size_t k) {
+        if (k >= size()) {
+            return SplayTree(nullptr, function, comp);
+        }
+
+        pending_splay.reset();
+        auto node = const_cast<Node *>(select_node(k))->get_ptr();
+        node->splay(*this);
+        root = node->unpin_left_subtree(*this);
+        if (root != nullptr) {
+            root->remove_parent();
+        }
+
+        return SplayTree(node, function, comp);
+    }
+
+    // Moves the values satisfying pred into the returned tree. Both trees are relinked balanced in O(n).
+    template<class Pred>
+    SplayTree partition(Pred pred) {
+        std::vector<node_ptr_t> kept, moved;
+        split_nodes(pred, kept, moved);
+
+        root = link_balanced(kept, 0, kept.size(), *this);
+        if (root != nullptr) {
+            root->remove_parent();
+        }
+
+        return from_sorted_nodes(moved, function, comp);
+    }
+
+    // Erases the values satisfying pred in one in-order pass and relinks the rest balanced. Returns the number
+    // of erased values.
+    template<class Pred>
+    friend size_t erase_if(SplayTree &tree, Pred pred) {
+        return tree._erase_if(pred);
+    }
+
+    SplayTree erase_less(const V &value) {
+        trace(TraceOperation::erase_less, value);
+        pending_splay.reset();
+        _search(value);
+        if (!compare(root->get_value(), value)) {
+            return SplayTree(root->unpin_left_subtree(*this), function, comp);
+        }
+
+        auto rest = root->unpin_right_subtree(*this);
+        auto result = SplayTree(std::exchange(root, rest), function, comp);
+        if (root != nullptr) {
+            root->remove_parent();
+        }
+
+        return result;
+    }
+
+    SplayTree erase_greater(const V &value) {
+        trace(TraceOperation::erase_greater, value);
+        pending_splay.reset();
         _search(value);
-        return !compare(root->get_value(), value) && !compare(value, root->get_value()) ?
-            Iterator<true>(traversal_t({root})) : end();
+        if (!compare(value, root->get_value())) {
+            return SplayTree(root->unpin_right_subtree(*this), function, comp);
+        }
+
+        auto rest = root->unpin_left_subtree(*this);
+        auto result = SplayTree(std::exchange(root, rest), function, comp);
+        if (root != nullptr) {
+            root->remove_parent();
+        }
+
+        return result;
+    }
+
+    void clear(size_t threads = 1) {
+        pending_splay.reset();
+        frozen_shape = nullptr;
+        std::vector<node_ptr_t> subtrees;
+        if (root != nullptr) {
+            subtrees.push_back(std::move(root));
+        }
+        root = nullptr;
+
+        while (subtrees.size() < thread_count(threads)) {
+            auto it = std::find_if(subtrees.begin(), subtrees.end(), [](const node_ptr_t &node) {
+                return node.use_count() == 1 && node->subtree_size > parallel_grain;
+            });
+            if (it == subtrees.end()) {
+                break;
+            }
+
+            auto node = *it;
+            subtrees.erase(it);
+            for (auto child : { &node->left, &node->right }) {
+                if (*child != nullptr) {
+                    subtrees.push_back(std::move(*child));
+                }
+            }
+        }
+
+        std::vector<std::future<void>> futures;
+        for (size_t i = 1; i < subtrees.size(); i++) {
+            futures.push_back(std::async(std::launch::async, [node = std::move(subtrees[i])]() mutable {
+                release(std::move(node));
+            }));
+        }
+        if (!subtrees.empty()) {
+            release(std::move(subtrees[0]));
+        }
+        for (auto &future : futures) {
+            future.get();
+        }
+    }
+
+    template<class F>
+    void parallel_for_each(F f, size_t threads = std::thread::hardware_concurrency()) const {
+        for_each_chunk(threads, [&](size_t, const Node *node, size_t length) {
+            for (; length > 0; length--, node = Node::successor(node)) {
+                f(node->value);
+            }
+        });
+    }
+
+    template<class T, class Combine, class Transform>
+    T parallel_reduce(T init, Combine combine, Transform transform,
+                      size_t threads = std::thread::hardware_concurrency()) const {
+        std::vector<std::optional<T>> partial(thread_count(threads));
+
+        for_each_chunk(threads, [&](size_t chunk, const Node *node, size_t length) {
+            T accumulator = transform(node->value);
+            for (node = Node::successor(node), length--; length > 0; length--, node = Node::successor(node)) {
+                accumulator = combine(std::move(accumulator), transform(node->value));
+            }
+            partial[chunk] = std::move(accumulator);
+        });
+
+        for (auto &value : partial) {
+            if (value) {
+                init = combine(std::move(init), std::move(*value));
+            }
+        }
+        return init;
+    }
+
+    void set_function(Function new_function, size_t threads = std::thread::hardware_concurrency()) {
+        function = new_function;
+        if (function) {
+            recompute_subtree(root.get(), *this, thread_count(threads));
+        }
+    }
+
+    Comp key_comp() const {
+        return comp;
+    }
+
+    // Builds a balanced tree from values strictly increasing under comp.
+    static SplayTree from_sorted(const std::vector<V> &values, Function function = Function(),
+                                 size_t threads = std::thread::hardware_concurrency(), Comp comp = Comp()) {
+        std::vector<node_ptr_t> nodes(values.size());
+
+        size_t chunks = std::min(thread_count(threads), std::max<size_t>(values.size() / parallel_grain, 1));
+        std::vector<std::future<void>> futures;
+        for (size_t chunk = 0; chunk < chunks; chunk++) {
+            futures.push_back(std::async(chunk + 1 == chunks ? std::launch::deferred : std::launch::async, [&, chunk]() {
+                for (size_t i = values.size() * chunk / chunks; i < values.size() * (chunk + 1) / chunks; i++) {
+                    nodes[i] = std::make_shared<Node>(values[i]);
+                }
+            }));
+        }
+        for (auto &future : futures) {
+            future.get();
+        }
+
+        return from_sorted_nodes(nodes, function, comp, thread_count(threads));
+    }
+
+    [[nodiscard]] bool empty() const {
+        return root == nullptr;
+    }
+
+    SplayTree set_union(const SplayTree &other) const {
+        return set_operation(other, [](auto... args) { return std::set_union(args...); });
+    }
+
+    SplayTree set_intersection(const SplayTree &other) const {
+        return set_operation(other, [](auto... args) { return std::set_intersection(args...); });
+    }
+
+    SplayTree set_difference(const SplayTree &other) const {
+        return set_operation(other, [](auto... args) { return std::set_difference(args...); });
+    }
+
+    SplayTree symmetric_difference(const SplayTree &other) const {
+        return set_operation(other, [](auto... args) { return std::set_symmetric_difference(args...); });
+    }
+
+    // Moves the nodes of other whose values are not present here; other keeps the rest.
+    void merge(SplayTree &other) {
+        if (this == &other || other.root == nullptr) {
+            return;
+        }
+
+        other.pending_splay.reset();
+        std::vector<node_ptr_t> nodes, kept;
+        nodes.reserve(other.size());
+        other.for_each_node([&](Node &node) { nodes.push_back(node.get_ptr()); });
+        other.root = nullptr;
+
+        for (auto &node : nodes) {
+            node->left = node->right = nullptr;
+            node->remove_parent();
+        }
+        for (auto &node : nodes) {
+            node->update(*this);
+            if (_contains(node->value)) {
+                kept.push_back(std::move(node));
+            }
+            else {
+                insert(node_type(std::move(node)));
+            }
+        }
+
+        other.root = link_balanced(kept, 0, kept.size(), other);
+        if (other.root != nullptr) {
+            other.root->remove_parent();
+        }
+    }
+
+    Iterator<true> find(const V &value) {
+        trace(TraceOperation::find, value);
+        if (root == nullptr) {
+            return end();
+        }
+
+        auto node = _access(value);
+        return !compare(node->value, value) && !compare(value, node->value) ? iterator_at(node.get()) : end();
     }
 
     Iterator<true> find(const V &value) const {
@@ -770,6 +2009,9 @@ public:
 
     void swap(SplayTree &other) {
         std::swap(root, other.root);
+        std::swap(function, other.function);
+        std::swap(comp, other.comp);
+        std::swap(splay_policy, other.splay_policy);
     }
 
     size_t count(const V &value) {
@@ -781,57 +2023,257 @@ public:
     }
 
     Iterator<true> lower_bound(const V &value) {
-        _search(value);
-        if (!compare(root->get_value(), value)) {
-            return Iterator<true>(traversal_t({root}));
+        trace(TraceOperation::lower_bound, value);
+        return iterator_at(splay_bound(value, false));
+    }
+
+    Iterator<true> upper_bound(const V &value) {
+        trace(TraceOperation::upper_bound, value);
+        return iterator_at(splay_bound(value, true));
+    }
+
+    std::optional<V> ceiling(const V &value) {
+        return optional_value(splay_bound(value, false));
+    }
+
+    std::optional<V> successor(const V &value) {
+        return optional_value(splay_bound(value, true));
+    }
+
+    std::optional<V> floor(const V &value) {
+        return optional_value(splay_reverse_bound(value, false));
+    }
+
+    std::optional<V> predecessor(const V &value) {
+        return optional_value(splay_reverse_bound(value, true));
+    }
+
+    Range range(const V &low, const V &high) const {
+        if (!compare(low, high)) {
+            return Range();
         }
-        else {
-            if (root->get_right() == nullptr) {
-                return end();
+        return Range(bound_no_splay(low, false), bound_no_splay(high, false));
+    }
+
+    // In-order visit that skips every subtree whose function value fails enter and stops as soon as visit
+    // returns false. Requires a Function; the last visited node is splayed.
+    template<class Enter, class Visit>
+    void visit_if(Enter enter, Visit visit) {
+        std::vector<Node *> stack;
+        auto push_left = [&](Node *node) {
+            for (; node != nullptr && enter(std::as_const(node->function_value)); node = node->left.get()) {
+                stack.push_back(node);
             }
+        };
+
+        Node *last = nullptr;
+        push_left(root.get());
+        while (!stack.empty()) {
+            last = stack.back();
+            stack.pop_back();
+            if (!visit(std::as_const(last->value))) {
+                break;
+            }
+            push_left(last->right.get());
+        }
 
-            node_ptr_t node = root->get_right();
-            traversal_t traversal({ root, root->get_right() });
+        if (last != nullptr) {
+            size_t depth = 0;
+            for (Node *node = last->parent.lock().get(); node != nullptr; node = node->parent.lock().get()) {
+                depth++;
+            }
+            splay_at_depth(last->get_ptr(), depth);
+        }
+    }
 
-            while (node->get_left() != nullptr) {
-                node = node->get_left();
-                traversal.push(node);
+    // First value whose prefix aggregate satisfies pred, or end(). The prefix aggregate of a value is folded with
+    // combine(prefix, part) from the function values of the subtrees and single values up to and including it,
+    // starting from the default value; pred must turn from false to true at most once along the order. Requires a
+    // Function; the node where the descent ends is splayed. With weight sums, pred = [x](auto w) { return w > x; }
+    // finds the value at weighted position x.
+    template<class Pred, class Combine>
+    Iterator<true> find_by_aggregate(Pred pred, Combine combine) {
+        Node *node = root.get();
+        Node *last = nullptr;
+        bool found = false;
+        size_t depth = 0;
+        FunctionType prefix = function.get_default();
+
+        while (node != nullptr) {
+            last = node;
+            FunctionType left = prefix;
+            if (node->left != nullptr) {
+                left = combine(std::as_const(prefix), std::as_const(node->left->function_value));
+                if (pred(std::as_const(left))) {
+                    node = node->left.get();
+                    depth++;
+                    continue;
+                }
             }
 
-            return Iterator<true>(traversal);
+            FunctionType with_node = combine(std::as_const(left), function(node->value, function.get_default(),
+                                                                           function.get_default()));
+            if (pred(std::as_const(with_node))) {
+                found = true;
+                break;
+            }
+            prefix = std::move(with_node);
+            node = node->right.get();
+            depth++;
         }
+
+        if (last == nullptr) {
+            return end();
+        }
+        if (!found) {
+            depth--;
+        }
+        splay_at_depth(last->get_ptr(), depth);
+
+        return found ? iterator_at(last) : end();
     }
 
-    Iterator<true> upper_bound(const V &value) {
-        _search(value);
-        if (compare(value, root->get_value())) {
-            return Iterator<true>(traversal_t({root}));
+    FunctionType get_function_value() const {
+        return Node::get_function_value(root, function);
+    }
+
+    void set_trace_hook(std::function<void(TraceOperation, const V &)> hook) {
+        trace_hook = std::move(hook);
+    }
+
+    [[nodiscard]] size_t rotations() const {
+        return rotation_count;
+    }
+
+    // Caps the rotations a single insert, lookup or erase spends on splaying (0 removes the cap). A splay cut
+    // short is continued by later operations with their leftover budget. Splits, extract and merge still
+    // splay fully. Not available with semi-splaying policies, whose lookups splay without a budget.
+    void set_rotation_budget(size_t budget) {
+        static_assert(!SplayPolicy::semi, "SplayTree: rotation budgets are not supported with semi-splaying");
+        rotation_budget = budget == 0 ? 0 : std::max<size_t>(budget, 2);
+        pending_splay.reset();
+    }
+
+    // Relinks the whole tree into balanced shape in linear time.
+    void rebalance() {
+        if (root != nullptr) {
+            rebuild(root);
         }
-        else {
-            if (root->get_right() == nullptr) {
-                return end();
-            }
+    }
 
-            node_ptr_t node = root->get_right();
-            traversal_t traversal({ root, root->get_right() });
+    // Rebuilds subtrees in which a lookup ends deeper than factor * log2(subtree size), so a long path left by an
+    // adversarial sequence is not paid for by a single access. A rebuild relinks at most budget nodes; a factor
+    // of 0 turns this off.
+    void set_rebalance(double factor, size_t budget = std::numeric_limits<size_t>::max()) {
+        rebalance_factor = factor;
+        rebalance_budget = budget;
+    }
 
-            while (node->get_left() != nullptr) {
-                node = node->get_left();
-                traversal.push(node);
+    [[nodiscard]] size_t rebalances() const {
+        return rebalance_count;
+    }
+
+    // Rebuilds the tree in O(n log n) so that values with a large weight(value) are near the root, within a
+    // constant factor of the optimal expected lookup cost. With a drift factor, splaying is frozen afterwards
+    // (lookups do not restructure the tree) until the observed lookup depth drifts beyond it; inserts and
+    // erases still splay.
+    template<std::invocable<const V &> Weight>
+    void reshape(Weight weight, std::optional<double> drift = std::nullopt) {
+        reshape_nodes([&](const Node &node) { return weight(node.value); }, drift);
+    }
+
+    // Reshapes using the sampled access counts; see enable_statistics().
+    void reshape(std::optional<double> drift = std::nullopt) {
+        reshape_nodes([](const Node &node) { return node.access_count; }, drift);
+    }
+
+    [[nodiscard]] bool frozen() const {
+        return frozen_shape != nullptr;
+    }
+
+    // Resumes splaying after a frozen reshape().
+    void thaw() {
+        frozen_shape = nullptr;
+    }
+
+    // Starts counting accesses, sampling one in every sample_period of them. Restarting clears the counters.
+    void enable_statistics(size_t sample_period = 1) {
+        reset_statistics();
+        statistics = std::make_unique<AccessStatistics>(sample_period);
+    }
+
+    void disable_statistics() {
+        statistics = nullptr;
+    }
+
+    void reset_statistics() {
+        for_each_node([](Node &node) { node.access_count = 0; });
+        if (statistics != nullptr) {
+            statistics->samples = 0;
+            statistics->depths.fill(0);
+        }
+    }
+
+    [[nodiscard]] size_t sampled_accesses() const {
+        return statistics == nullptr ? 0 : statistics->samples;
+    }
+
+    // The k values with the most sampled accesses, hottest first.
+    std::vector<std::pair<V, size_t>> hottest(size_t k) const {
+        std::vector<const Node *> nodes;
+        for_each_node([&](const Node &node) {
+            if (node.access_count > 0) {
+                nodes.push_back(&node);
             }
+        });
 
-            return Iterator<true>(traversal);
+        k = std::min(k, nodes.size());
+        std::partial_sort(nodes.begin(), nodes.begin() + static_cast<std::ptrdiff_t>(k), nodes.end(),
+                          [](const Node *node1, const Node *node2) {
+                              return node1->access_count > node2->access_count;
+                          });
+
+        std::vector<std::pair<V, size_t>> result;
+        result.reserve(k);
+        for (size_t i = 0; i < k; i++) {
+            result.emplace_back(nodes[i]->value, nodes[i]->access_count);
         }
+
+        return result;
     }
 
-     FunctionType get_function_value() const {
-        return Node::get_function_value(root, function);
+    // Sampled lookups by depth of the node where the search ended; the last bucket also counts deeper ones.
+    std::vector<size_t> depth_histogram() const {
+        if (statistics == nullptr) {
+            return {};
+        }
+
+        auto &depths = statistics->depths;
+        auto last = std::find_if(depths.rbegin(), depths.rend(), [](size_t count) { return count > 0; });
+        return std::vector<size_t>(depths.begin(), last.base());
     }
 
+    SplayTree(const SplayTree &other)
+            : root(other.root), function(other.function), comp(other.comp), splay_policy(other.splay_policy) {}
+
     SplayTree &operator =(const SplayTree &other) {
-        function = other.function;
-        root = other.root;
+        if (this != &other) {
+            pending_splay.reset();
+            frozen_shape = nullptr;
+            auto old_root = std::move(root);
+            function = other.function;
+            comp = other.comp;
+            splay_policy = other.splay_policy;
+            root = other.root;
+            release(std::move(old_root));
+        }
 
         return *this;
     }
-};
\ No newline at end of file
+
+    ~SplayTree() {
+        clear();
+    }
+};
+
+#endif // SPLAY_H
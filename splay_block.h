@@ -0,0 +1,420 @@
+#ifndef SPLAY_BLOCK_H
+#define SPLAY_BLOCK_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "splay_engine.h"
+
+template<class V, class Comp>
+concept BlockSearchable = std::is_arithmetic_v<V>
+        && (std::is_same_v<Comp, std::less<V>> || std::is_same_v<Comp, std::less<>>
+            || std::is_same_v<Comp, std::greater<V>> || std::is_same_v<Comp, std::greater<>>);
+
+// Splay tree over sorted blocks of up to BlockSize keys. Splaying works at block granularity and the
+// position inside a block is found with a branch-free (and, where available, vectorized) count.
+template<class V, class Comp = std::less<V>, size_t BlockSize = 32> requires BlockSearchable<V, Comp>
+class BlockSplayTree {
+    static_assert(BlockSize >= 8 && BlockSize % 8 == 0, "BlockSize must be a positive multiple of 8");
+
+    using index_t = std::uint32_t;
+
+    static constexpr bool decreasing = std::is_same_v<Comp, std::greater<V>> || std::is_same_v<Comp, std::greater<>>;
+
+    // Padding sorts after every key, so full-width comparisons never count unused slots. Floating-point
+    // blocks pad with infinity, so that even an infinite key does not order after the padding.
+    static constexpr V padding = std::numeric_limits<V>::has_infinity
+            ? (decreasing ? -std::numeric_limits<V>::infinity() : std::numeric_limits<V>::infinity())
+            : (decreasing ? std::numeric_limits<V>::lowest() : std::numeric_limits<V>::max());
+
+    struct Block {
+        index_t left, right, parent;
+        index_t count;
+        size_t subtree_size;
+        alignas(32) std::array<V, BlockSize> keys;
+    };
+
+    class Storage {
+        BlockSplayTree *tree;
+
+    public:
+        using node_t = index_t;
+        static constexpr node_t nil = std::numeric_limits<index_t>::max();
+
+        explicit Storage(BlockSplayTree *tree) : tree(tree) {}
+
+        index_t &left(index_t x) {
+            return tree->blocks[x].left;
+        }
+
+        index_t &right(index_t x) {
+            return tree->blocks[x].right;
+        }
+
+        index_t &parent(index_t x) {
+            return tree->blocks[x].parent;
+        }
+
+        void update(index_t x) {
+            tree->update(x);
+        }
+    };
+
+    using engine_t = SplayEngine<Storage>;
+
+    static constexpr index_t nil = Storage::nil;
+
+    std::vector<Block> blocks;
+    index_t root = nil;
+    index_t free_list = nil;
+
+    [[nodiscard]] static bool compare(const V &value1, const V &value2) {
+        return Comp{}(value1, value2);
+    }
+
+    Storage storage() const {
+        return Storage(const_cast<BlockSplayTree *>(this));
+    }
+
+    [[nodiscard]] size_t get_subtree_size(index_t x) const {
+        return x == nil ? 0 : blocks[x].subtree_size;
+    }
+
+    void update(index_t x) {
+        Block &b = blocks[x];
+        b.subtree_size = b.count + get_subtree_size(b.left) + get_subtree_size(b.right);
+    }
+
+    index_t allocate() {
+        index_t x;
+        if (free_list != nil) {
+            x = free_list;
+            free_list = blocks[x].left;
+        }
+        else {
+            x = static_cast<index_t>(blocks.size());
+            blocks.emplace_back();
+        }
+
+        Block &b = blocks[x];
+        b.left = b.right = b.parent = nil;
+        b.count = 0;
+        b.subtree_size = 0;
+        b.keys.fill(padding);
+
+        return x;
+    }
+
+    void deallocate(index_t x) {
+        blocks[x].left = free_list;
+        free_list = x;
+    }
+
+    // NaN orders neither before nor after any key, so it is never stored.
+    [[nodiscard]] static bool is_unordered(const V &value) {
+        return value != value;
+    }
+
+    // Number of keys in the block ordered before value, i.e. the in-block lower bound.
+    static index_t rank_in_block(const Block &b, const V &value) {
+        return std::min(count_before(b, value), b.count);
+    }
+
+    static index_t count_before(const Block &b, const V &value) {
+#if defined(__AVX2__)
+        if constexpr (std::is_integral_v<V> && std::is_signed_v<V> && sizeof(V) == 4) {
+            const __m256i probe = _mm256_set1_epi32(static_cast<int>(value));
+            index_t rank = 0;
+            for (size_t i = 0; i < BlockSize; i += 8) {
+                __m256i keys = _mm256_load_si256(reinterpret_cast<const __m256i *>(b.keys.data() + i));
+                __m256i less = decreasing ? _mm256_cmpgt_epi32(keys, probe) : _mm256_cmpgt_epi32(probe, keys);
+                rank += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(less)));
+            }
+            return rank;
+        }
+        if constexpr (std::is_integral_v<V> && std::is_signed_v<V> && sizeof(V) == 8) {
+            const __m256i probe = _mm256_set1_epi64x(static_cast<long long>(value));
+            index_t rank = 0;
+            for (size_t i = 0; i < BlockSize; i += 4) {
+                __m256i keys = _mm256_load_si256(reinterpret_cast<const __m256i *>(b.keys.data() + i));
+                __m256i less = decreasing ? _mm256_cmpgt_epi64(keys, probe) : _mm256_cmpgt_epi64(probe, keys);
+                rank += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(less)));
+            }
+            return rank;
+        }
+#elif defined(__SSE2__)
+        if constexpr (std::is_integral_v<V> && std::is_signed_v<V> && sizeof(V) == 4) {
+            const __m128i probe = _mm_set1_epi32(static_cast<int>(value));
+            index_t rank = 0;
+            for (size_t i = 0; i < BlockSize; i += 4) {
+                __m128i keys = _mm_load_si128(reinterpret_cast<const __m128i *>(b.keys.data() + i));
+                __m128i less = decreasing ? _mm_cmpgt_epi32(keys, probe) : _mm_cmpgt_epi32(probe, keys);
+                rank += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(less)));
+            }
+            return rank;
+        }
+#endif
+        index_t rank = 0;
+        for (size_t i = 0; i < BlockSize; i++) {
+            rank += compare(b.keys[i], value);
+        }
+        return rank;
+    }
+
+    std::pair<index_t, int> descend(const V &value) const {
+        auto s = storage();
+        return engine_t::descend(s, root, [&](index_t x) {
+            const Block &b = blocks[x];
+            return compare(value, b.keys[0]) ? -1 : compare(b.keys[b.count - 1], value) ? 1 : 0;
+        });
+    }
+
+    void splay(index_t x) {
+        auto s = storage();
+        engine_t::splay(s, x);
+        root = x;
+    }
+
+    // Moves the upper half of the full root block into a new block linked as its in-order successor.
+    void split_root() {
+        index_t y = allocate();
+        Block &b = blocks[root];
+        Block &upper = blocks[y];
+
+        index_t half = b.count / 2;
+        upper.count = b.count - half;
+        std::copy(b.keys.begin() + half, b.keys.begin() + b.count, upper.keys.begin());
+        std::fill(b.keys.begin() + half, b.keys.end(), padding);
+        b.count = half;
+
+        upper.right = b.right;
+        if (upper.right != nil) {
+            blocks[upper.right].parent = y;
+        }
+        upper.parent = root;
+        b.right = y;
+
+        update(y);
+        update(root);
+    }
+
+    // Merges the in-order successor of the root block into it when both fit into one block.
+    void merge_with_next() {
+        Block &b = blocks[root];
+        if (b.right == nil) {
+            return;
+        }
+
+        auto s = storage();
+        index_t next = engine_t::first(s, b.right);
+        Block &n = blocks[next];
+        if (b.count + n.count > BlockSize) {
+            return;
+        }
+
+        std::copy(n.keys.begin(), n.keys.begin() + n.count, b.keys.begin() + b.count);
+        b.count += n.count;
+
+        index_t parent = n.parent;
+        index_t child = n.right;
+        if (blocks[parent].left == next) {
+            blocks[parent].left = child;
+        }
+        else {
+            blocks[parent].right = child;
+        }
+        if (child != nil) {
+            blocks[child].parent = parent;
+        }
+        for (index_t x = parent; x != nil; x = blocks[x].parent) {
+            update(x);
+        }
+
+        deallocate(next);
+    }
+
+public:
+    class Iterator {
+        const BlockSplayTree *tree = nullptr;
+        index_t block = nil;
+        index_t position = 0;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = V;
+        using pointer = const V *;
+        using reference = const V &;
+
+        Iterator() = default;
+
+        Iterator(const BlockSplayTree *tree, index_t block, index_t position)
+                : tree(tree), block(block), position(position) {}
+
+        bool operator==(const Iterator &other) const {
+            return block == other.block && position == other.position;
+        }
+
+        reference operator*() const {
+            return tree->blocks[block].keys[position];
+        }
+
+        pointer operator->() const {
+            return &tree->blocks[block].keys[position];
+        }
+
+        Iterator &operator++() {
+            if (++position == tree->blocks[block].count) {
+                auto s = tree->storage();
+                block = engine_t::next(s, block);
+                position = 0;
+            }
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator temp = *this;
+            ++*this;
+            return temp;
+        }
+    };
+
+    BlockSplayTree() = default;
+
+    BlockSplayTree(std::initializer_list<V> values) {
+        for (const V &value : values) {
+            insert(value);
+        }
+    }
+
+    Iterator begin() const {
+        auto s = storage();
+        return Iterator(this, engine_t::first(s, root), 0);
+    }
+
+    Iterator end() const {
+        return Iterator(this, nil, 0);
+    }
+
+    bool insert(const V &value) {
+        if (is_unordered(value)) {
+            return false;
+        }
+        if (root == nil) {
+            root = allocate();
+            blocks[root].keys[0] = value;
+            blocks[root].count = 1;
+            update(root);
+            return true;
+        }
+
+        splay(descend(value).first);
+
+        index_t position = rank_in_block(blocks[root], value);
+        if (position < blocks[root].count && !compare(value, blocks[root].keys[position])) {
+            return false;
+        }
+
+        if (blocks[root].count == BlockSize) {
+            split_root();
+            if (position > blocks[root].count) {
+                splay(blocks[root].right);
+                position -= blocks[blocks[root].left].count;
+            }
+        }
+
+        Block &b = blocks[root];
+        std::copy_backward(b.keys.begin() + position, b.keys.begin() + b.count, b.keys.begin() + b.count + 1);
+        b.keys[position] = value;
+        b.count++;
+        update(root);
+
+        return true;
+    }
+
+    bool contains(const V &value) {
+        if (root == nil || is_unordered(value)) {
+            return false;
+        }
+
+        auto [block, dir] = descend(value);
+        splay(block);
+        if (dir != 0) {
+            return false;
+        }
+
+        index_t position = rank_in_block(blocks[root], value);
+        return position < blocks[root].count && !compare(value, blocks[root].keys[position]);
+    }
+
+    bool contains(const V &value) const {
+        if (root == nil || is_unordered(value)) {
+            return false;
+        }
+
+        auto [block, dir] = descend(value);
+        if (dir != 0) {
+            return false;
+        }
+
+        index_t position = rank_in_block(blocks[block], value);
+        return position < blocks[block].count && !compare(value, blocks[block].keys[position]);
+    }
+
+    bool erase(const V &value) {
+        if (!contains(value)) {
+            return false;
+        }
+
+        Block &b = blocks[root];
+        index_t position = rank_in_block(b, value);
+        std::copy(b.keys.begin() + position + 1, b.keys.begin() + b.count, b.keys.begin() + position);
+        b.count--;
+        b.keys[b.count] = padding;
+
+        if (b.count == 0) {
+            index_t x = root;
+            auto s = storage();
+            root = engine_t::remove_root(s, x);
+            if (root != nil) {
+                blocks[root].parent = nil;
+            }
+            deallocate(x);
+        }
+        else {
+            if (b.count < BlockSize / 4) {
+                merge_with_next();
+            }
+            update(root);
+        }
+
+        return true;
+    }
+
+    void clear() {
+        blocks.clear();
+        root = nil;
+        free_list = nil;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return get_subtree_size(root);
+    }
+
+    [[nodiscard]] bool empty() const {
+        return root == nil;
+    }
+};
+
+#endif // SPLAY_BLOCK_H
@@ -0,0 +1,284 @@
+#ifndef SPLAY_CACHE_H
+#define SPLAY_CACHE_H
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "splay.h"
+#include "splay_engine.h"
+
+// Bounded key-value cache indexed by a splay tree. Every hit splays the entry to the root and moves it to the
+// front of an intrusive recency list; when a limit is exceeded the list tail is evicted. Finding the tail is O(1),
+// but removing it from the tree splays it, so an eviction costs O(log n) amortized like any other removal.
+// Evicted and erased entries release their key and value at once; only the slot is kept for reuse. An entry
+// that cannot fit on its own, larger than max_bytes or with max_entries == 0, is not stored at all.
+template<class K, class T, Comparator<K> Comp = std::less<K>>
+class SplayCache {
+public:
+    using sizer_t = std::function<size_t(const K &, const T &)>;
+
+    struct Statistics {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+    };
+
+private:
+    using index_t = std::uint32_t;
+
+    struct Entry {
+        index_t left, right, parent;
+        index_t newer, older;
+        size_t bytes;
+        std::optional<K> key;
+        std::optional<T> value;
+    };
+
+    class Storage {
+        SplayCache *cache;
+
+    public:
+        using node_t = index_t;
+        static constexpr node_t nil = std::numeric_limits<index_t>::max();
+
+        explicit Storage(SplayCache *cache) : cache(cache) {}
+
+        index_t &left(index_t x) {
+            return cache->entries[x].left;
+        }
+
+        index_t &right(index_t x) {
+            return cache->entries[x].right;
+        }
+
+        index_t &parent(index_t x) {
+            return cache->entries[x].parent;
+        }
+
+        void update(index_t) {}
+    };
+
+    using engine_t = SplayEngine<Storage>;
+
+    static constexpr index_t nil = Storage::nil;
+
+    std::vector<Entry> entries;
+    index_t root = nil;
+    index_t free_list = nil;
+    index_t newest = nil;
+    index_t oldest = nil;
+
+    size_t max_entries;
+    size_t max_bytes;
+    sizer_t sizer;
+
+    size_t entry_count = 0;
+    size_t byte_count = 0;
+    Statistics stats;
+
+    [[nodiscard]] static bool compare(const K &key1, const K &key2) {
+        return Comp{}(key1, key2);
+    }
+
+    Storage storage() const {
+        return Storage(const_cast<SplayCache *>(this));
+    }
+
+    std::pair<index_t, int> descend(const K &key) const {
+        auto s = storage();
+        return engine_t::descend(s, root, [&](index_t x) {
+            const K &current = *entries[x].key;
+            return compare(key, current) ? -1 : compare(current, key) ? 1 : 0;
+        });
+    }
+
+    void splay(index_t x) {
+        auto s = storage();
+        engine_t::splay(s, x);
+        root = x;
+    }
+
+    void unlink_recency(index_t x) {
+        Entry &e = entries[x];
+        if (e.newer != nil) {
+            entries[e.newer].older = e.older;
+        }
+        else {
+            newest = e.older;
+        }
+        if (e.older != nil) {
+            entries[e.older].newer = e.newer;
+        }
+        else {
+            oldest = e.newer;
+        }
+    }
+
+    void push_recency(index_t x) {
+        Entry &e = entries[x];
+        e.newer = nil;
+        e.older = newest;
+        if (newest != nil) {
+            entries[newest].newer = x;
+        }
+        newest = x;
+        if (oldest == nil) {
+            oldest = x;
+        }
+    }
+
+    void touch(index_t x) {
+        if (newest != x) {
+            unlink_recency(x);
+            push_recency(x);
+        }
+    }
+
+    void remove(index_t x) {
+        splay(x);
+        auto s = storage();
+        root = engine_t::remove_root(s, x);
+        if (root != nil) {
+            entries[root].parent = nil;
+        }
+
+        unlink_recency(x);
+        entry_count--;
+        byte_count -= entries[x].bytes;
+
+        entries[x].key.reset();
+        entries[x].value.reset();
+        entries[x].left = free_list;
+        free_list = x;
+    }
+
+    // The newest entry fits on its own, so the loop stops before reaching it.
+    void evict() {
+        while (entry_count > max_entries || byte_count > max_bytes) {
+            remove(oldest);
+            stats.evictions++;
+        }
+    }
+
+public:
+    explicit SplayCache(size_t max_entries, size_t max_bytes = std::numeric_limits<size_t>::max(),
+                        sizer_t sizer = [](const K &, const T &) { return sizeof(K) + sizeof(T); })
+            : max_entries(max_entries), max_bytes(max_bytes), sizer(std::move(sizer)) {}
+
+    // The pointer is invalidated by the next put, which may reallocate the entries, and by erase or clear.
+    T *get(const K &key) {
+        auto [x, dir] = descend(key);
+        if (x == nil) {
+            stats.misses++;
+            return nullptr;
+        }
+
+        splay(x);
+        if (dir != 0) {
+            stats.misses++;
+            return nullptr;
+        }
+
+        stats.hits++;
+        touch(x);
+        return &*entries[x].value;
+    }
+
+    // Stores value under key and returns whether it was stored. A value that cannot fit on its own is dropped,
+    // together with any older value under key.
+    bool put(const K &key, T value) {
+        size_t bytes = sizer(key, value);
+        if (max_entries == 0 || bytes > max_bytes) {
+            erase(key);
+            return false;
+        }
+
+        auto [x, dir] = descend(key);
+
+        if (x != nil && dir == 0) {
+            Entry &e = entries[x];
+            byte_count += bytes - e.bytes;
+            e.bytes = bytes;
+            e.value = std::move(value);
+            splay(x);
+            touch(x);
+            evict();
+            return true;
+        }
+
+        index_t y;
+        if (free_list != nil) {
+            y = free_list;
+            free_list = entries[y].left;
+            entries[y].key = key;
+            entries[y].value = std::move(value);
+        }
+        else {
+            y = static_cast<index_t>(entries.size());
+            entries.push_back(Entry { nil, nil, nil, nil, nil, 0, key, std::move(value) });
+        }
+
+        Entry &e = entries[y];
+        e.left = e.right = e.parent = nil;
+        e.bytes = bytes;
+        if (x != nil) {
+            auto s = storage();
+            engine_t::attach(s, x, y, dir);
+        }
+        splay(y);
+        push_recency(y);
+
+        entry_count++;
+        byte_count += bytes;
+        evict();
+
+        return true;
+    }
+
+    bool erase(const K &key) {
+        auto [x, dir] = descend(key);
+        if (x == nil || dir != 0) {
+            return false;
+        }
+
+        remove(x);
+        return true;
+    }
+
+    [[nodiscard]] bool contains(const K &key) const {
+        auto [x, dir] = descend(key);
+        return x != nil && dir == 0;
+    }
+
+    void clear() {
+        entries.clear();
+        root = free_list = newest = oldest = nil;
+        entry_count = 0;
+        byte_count = 0;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return entry_count;
+    }
+
+    [[nodiscard]] size_t bytes() const {
+        return byte_count;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return entry_count == 0;
+    }
+
+    const Statistics &statistics() const {
+        return stats;
+    }
+
+    void reset_statistics() {
+        stats = Statistics();
+    }
+};
+
+#endif // SPLAY_CACHE_H
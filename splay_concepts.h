@@ -0,0 +1,11 @@
+#ifndef SPLAY_CONCEPTS_H
+#define SPLAY_CONCEPTS_H
+
+#include <concepts>
+
+template<class C, class V>
+concept Comparator = requires(C c, const V &x, const V &y) {
+    { c(x, y) } -> std::same_as<bool>;
+};
+
+#endif // SPLAY_CONCEPTS_H
@@ -0,0 +1,197 @@
+#ifndef SPLAY_ENGINE_H
+#define SPLAY_ENGINE_H
+
+#include <utility>
+
+// Rotation and splaying algorithms shared by the node-handle based containers (index or pointer links).
+// Storage provides node_t, the nil handle, left/right/parent accessors returning references
+// and update(x), which recomputes the subtree data of x from its children.
+template<class Storage>
+class SplayEngine {
+public:
+    using node_t = typename Storage::node_t;
+
+    static constexpr node_t nil = Storage::nil;
+
+    static constexpr bool is_root(Storage &s, node_t x) {
+        node_t p = s.parent(x);
+        return p == nil || (s.left(p) != x && s.right(p) != x);
+    }
+
+    static constexpr void rotate(Storage &s, node_t x) {
+        node_t p = s.parent(x);
+        node_t g = s.parent(p);
+        bool parent_is_root = is_root(s, p);
+
+        if (s.left(p) == x) {
+            node_t child = s.right(x);
+            s.left(p) = child;
+            if (child != nil) {
+                s.parent(child) = p;
+            }
+            s.right(x) = p;
+        }
+        else {
+            node_t child = s.left(x);
+            s.right(p) = child;
+            if (child != nil) {
+                s.parent(child) = p;
+            }
+            s.left(x) = p;
+        }
+
+        s.parent(p) = x;
+        s.parent(x) = g;
+
+        if (!parent_is_root) {
+            if (s.left(g) == p) {
+                s.left(g) = x;
+            }
+            else {
+                s.right(g) = x;
+            }
+        }
+
+        s.update(p);
+        s.update(x);
+    }
+
+    static constexpr void local_splay(Storage &s, node_t x) {
+        node_t p = s.parent(x);
+
+        if (!is_root(s, p)) {
+            node_t g = s.parent(p);
+            if ((s.left(g) == p) == (s.left(p) == x)) {
+                rotate(s, p);
+            }
+            else {
+                rotate(s, x);
+            }
+        }
+        rotate(s, x);
+    }
+
+    static constexpr void splay(Storage &s, node_t x) {
+        while (!is_root(s, x)) {
+            local_splay(s, x);
+        }
+    }
+
+    static constexpr node_t first(Storage &s, node_t x) {
+        if (x == nil) {
+            return nil;
+        }
+        while (s.left(x) != nil) {
+            x = s.left(x);
+        }
+        return x;
+    }
+
+    static constexpr node_t last(Storage &s, node_t x) {
+        if (x == nil) {
+            return nil;
+        }
+        while (s.right(x) != nil) {
+            x = s.right(x);
+        }
+        return x;
+    }
+
+    static constexpr node_t next(Storage &s, node_t x) {
+        if (s.right(x) != nil) {
+            return first(s, s.right(x));
+        }
+        node_t p = s.parent(x);
+        while (p != nil && s.right(p) == x) {
+            x = p;
+            p = s.parent(p);
+        }
+        return p;
+    }
+
+    static constexpr node_t previous(Storage &s, node_t x) {
+        if (s.left(x) != nil) {
+            return last(s, s.left(x));
+        }
+        node_t p = s.parent(x);
+        while (p != nil && s.left(p) == x) {
+            x = p;
+            p = s.parent(p);
+        }
+        return p;
+    }
+
+    // Descends from root guided by direction(x) (< 0 left, > 0 right, 0 found).
+    // Returns the last visited node together with the last direction taken there.
+    template<class Direction>
+    static constexpr std::pair<node_t, int> descend(Storage &s, node_t root, Direction direction) {
+        node_t x = root;
+        node_t last_visited = nil;
+        int dir = 0;
+
+        while (x != nil) {
+            last_visited = x;
+            dir = direction(x);
+            if (dir < 0) {
+                x = s.left(x);
+            }
+            else if (dir > 0) {
+                x = s.right(x);
+            }
+            else {
+                break;
+            }
+        }
+
+        return { last_visited, dir };
+    }
+
+    static constexpr void attach(Storage &s, node_t parent, node_t x, int side) {
+        if (side < 0) {
+            s.left(parent) = x;
+        }
+        else {
+            s.right(parent) = x;
+        }
+        s.parent(x) = parent;
+        s.update(parent);
+    }
+
+    // Joins two detached trees, all elements of a preceding all elements of b. Returns the new root.
+    static constexpr node_t join(Storage &s, node_t a, node_t b) {
+        if (a == nil) {
+            return b;
+        }
+        if (b == nil) {
+            return a;
+        }
+
+        node_t x = last(s, a);
+        splay(s, x);
+        s.right(x) = b;
+        s.parent(b) = x;
+        s.update(x);
+
+        return x;
+    }
+
+    // Unlinks the root x from its children and returns the root of the joined remainder.
+    static constexpr node_t remove_root(Storage &s, node_t x) {
+        node_t l = s.left(x);
+        node_t r = s.right(x);
+
+        if (l != nil) {
+            s.parent(l) = nil;
+        }
+        if (r != nil) {
+            s.parent(r) = nil;
+        }
+        s.left(x) = nil;
+        s.right(x) = nil;
+        s.update(x);
+
+        return join(s, l, r);
+    }
+};
+
+#endif // SPLAY_ENGINE_H
@@ -0,0 +1,321 @@
+#ifndef SPLAY_EULER_TOUR_H
+#define SPLAY_EULER_TOUR_H
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "splay_engine.h"
+
+// Euler-tour tree over a dynamic forest. Every tree is stored as its Euler tour (one node per vertex and one
+// per directed edge) in an implicit-key splay sequence, so rerooting, linking and cutting are a few splits
+// and joins. Sizes and aggregates count vertex nodes only.
+template<class T>
+class EulerTourTree {
+public:
+    using vertex_t = std::uint32_t;
+
+    class Monoid {
+        using combine_t = std::function<T(const T &, const T &)>;
+
+        combine_t combine;
+        T identity;
+
+    public:
+        Monoid(combine_t &&combine, T identity) : combine(std::move(combine)), identity(identity) {}
+
+        Monoid() = default;
+
+        explicit operator bool() const {
+            return static_cast<bool>(combine);
+        }
+
+        T operator ()(const T &left, const T &right) const {
+            return combine(left, right);
+        }
+
+        const T &get_identity() const {
+            return identity;
+        }
+    };
+
+private:
+    using node_t = std::uint32_t;
+
+    struct Node {
+        node_t left, right, parent;
+        std::uint32_t length;
+        std::uint32_t vertex_count;
+        bool is_vertex;
+        T value;
+        T function_value;
+    };
+
+    class Storage {
+        EulerTourTree *tree;
+
+    public:
+        using node_t = EulerTourTree::node_t;
+        static constexpr node_t nil = std::numeric_limits<node_t>::max();
+
+        explicit Storage(EulerTourTree *tree) : tree(tree) {}
+
+        node_t &left(node_t x) {
+            return tree->nodes[x].left;
+        }
+
+        node_t &right(node_t x) {
+            return tree->nodes[x].right;
+        }
+
+        node_t &parent(node_t x) {
+            return tree->nodes[x].parent;
+        }
+
+        void update(node_t x) {
+            tree->update(x);
+        }
+    };
+
+    using engine_t = SplayEngine<Storage>;
+
+    static constexpr node_t nil = Storage::nil;
+
+    std::vector<Node> nodes;
+    std::vector<node_t> vertex_nodes;
+    std::map<std::pair<vertex_t, vertex_t>, node_t> edges;
+    node_t free_list = nil;
+    Monoid monoid;
+
+    Storage storage() {
+        return Storage(this);
+    }
+
+    [[nodiscard]] std::uint32_t get_length(node_t x) const {
+        return x == nil ? 0 : nodes[x].length;
+    }
+
+    [[nodiscard]] std::uint32_t get_vertex_count(node_t x) const {
+        return x == nil ? 0 : nodes[x].vertex_count;
+    }
+
+    T get_function_value(node_t x) const {
+        return x == nil ? monoid.get_identity() : nodes[x].function_value;
+    }
+
+    void update(node_t x) {
+        Node &n = nodes[x];
+        n.length = 1 + get_length(n.left) + get_length(n.right);
+        n.vertex_count = n.is_vertex + get_vertex_count(n.left) + get_vertex_count(n.right);
+        if (monoid) {
+            T own = n.is_vertex ? n.value : monoid.get_identity();
+            n.function_value = monoid(monoid(get_function_value(n.left), own), get_function_value(n.right));
+        }
+    }
+
+    node_t allocate_edge() {
+        node_t x;
+        if (free_list != nil) {
+            x = free_list;
+            free_list = nodes[x].left;
+        }
+        else {
+            x = static_cast<node_t>(nodes.size());
+            nodes.emplace_back();
+        }
+
+        nodes[x] = Node { nil, nil, nil, 0, 0, false, monoid.get_identity(), monoid.get_identity() };
+        update(x);
+
+        return x;
+    }
+
+    void deallocate_edge(node_t x) {
+        nodes[x].left = free_list;
+        free_list = x;
+    }
+
+    void splay(node_t x) {
+        auto s = storage();
+        engine_t::splay(s, x);
+    }
+
+    node_t join(node_t a, node_t b) {
+        auto s = storage();
+        return engine_t::join(s, a, b);
+    }
+
+    // Splits the sequence containing x right before x. Returns the detached prefix; x becomes the root of the rest.
+    node_t split_before(node_t x) {
+        splay(x);
+        node_t prefix = nodes[x].left;
+        if (prefix != nil) {
+            nodes[prefix].parent = nil;
+            nodes[x].left = nil;
+            update(x);
+        }
+        return prefix;
+    }
+
+    // Splits the sequence containing x right after x. Returns the detached suffix; x becomes the root of the rest.
+    node_t split_after(node_t x) {
+        splay(x);
+        node_t suffix = nodes[x].right;
+        if (suffix != nil) {
+            nodes[suffix].parent = nil;
+            nodes[x].right = nil;
+            update(x);
+        }
+        return suffix;
+    }
+
+    std::uint32_t position(node_t x) {
+        splay(x);
+        return get_length(nodes[x].left);
+    }
+
+    // Rotates the tour of v's tree so that it starts at v.
+    void reroot(vertex_t v) {
+        node_t x = vertex_nodes[v];
+        node_t prefix = split_before(x);
+        join(x, prefix);
+    }
+
+    std::optional<node_t> find_edge(vertex_t u, vertex_t v) const {
+        auto it = edges.find({ u, v });
+        return it == edges.end() ? std::nullopt : std::optional<node_t>(it->second);
+    }
+
+public:
+    explicit EulerTourTree(size_t n, const T &value = T(), Monoid monoid = Monoid()) : monoid(monoid) {
+        vertex_nodes.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            add_vertex(value);
+        }
+    }
+
+    vertex_t add_vertex(const T &value) {
+        auto x = static_cast<node_t>(nodes.size());
+        nodes.push_back(Node { nil, nil, nil, 0, 0, true, value, value });
+        update(x);
+
+        vertex_nodes.push_back(x);
+        return static_cast<vertex_t>(vertex_nodes.size() - 1);
+    }
+
+    [[nodiscard]] size_t size() const {
+        return vertex_nodes.size();
+    }
+
+    bool connected(vertex_t u, vertex_t v) {
+        if (u == v) {
+            return true;
+        }
+
+        splay(vertex_nodes[u]);
+        splay(vertex_nodes[v]);
+        return nodes[vertex_nodes[u]].parent != nil;
+    }
+
+    bool link(vertex_t u, vertex_t v) {
+        if (connected(u, v)) {
+            return false;
+        }
+
+        reroot(u);
+        reroot(v);
+
+        node_t forward = allocate_edge();
+        node_t backward = allocate_edge();
+        edges[{ u, v }] = forward;
+        edges[{ v, u }] = backward;
+
+        node_t x = vertex_nodes[u];
+        node_t y = vertex_nodes[v];
+        splay(x);
+        splay(y);
+        join(join(join(x, forward), y), backward);
+
+        return true;
+    }
+
+    bool cut(vertex_t u, vertex_t v) {
+        auto forward = find_edge(u, v);
+        if (!forward) {
+            return false;
+        }
+        node_t first = *forward;
+        node_t second = edges[{ v, u }];
+
+        if (position(first) > position(second)) {
+            std::swap(first, second);
+        }
+
+        // The tour is A first B second C; B becomes one tree and A C the other.
+        node_t prefix = split_before(first);
+        split_after(first);
+        split_before(second);
+        node_t suffix = split_after(second);
+        join(prefix, suffix);
+
+        edges.erase({ u, v });
+        edges.erase({ v, u });
+        deallocate_edge(first);
+        deallocate_edge(second);
+
+        return true;
+    }
+
+    // Number of vertices in the tree containing v.
+    size_t component_size(vertex_t v) {
+        splay(vertex_nodes[v]);
+        return nodes[vertex_nodes[v]].vertex_count;
+    }
+
+    T component_function_value(vertex_t v) {
+        splay(vertex_nodes[v]);
+        return nodes[vertex_nodes[v]].function_value;
+    }
+
+    // Size and aggregate of the subtree of v when the tree is rooted so that parent is v's parent.
+    std::optional<std::pair<size_t, T>> subtree(vertex_t v, vertex_t parent) {
+        auto down = find_edge(parent, v);
+        if (!down) {
+            return std::nullopt;
+        }
+        node_t head = *down;
+        node_t up = edges[{ v, parent }];
+
+        // After rerooting at parent the tour is A head M up C, where M is the tour of v's subtree.
+        reroot(parent);
+        split_after(head);
+        node_t middle = split_before(up);
+
+        std::pair<size_t, T> result = { nodes[middle].vertex_count, get_function_value(middle) };
+        join(join(head, middle), up);
+
+        return result;
+    }
+
+    size_t subtree_size(vertex_t v, vertex_t parent) {
+        auto result = subtree(v, parent);
+        return result ? result->first : 0;
+    }
+
+    const T &get_value(vertex_t v) const {
+        return nodes[vertex_nodes[v]].value;
+    }
+
+    void set_value(vertex_t v, const T &value) {
+        node_t x = vertex_nodes[v];
+        splay(x);
+        nodes[x].value = value;
+        update(x);
+    }
+};
+
+#endif // SPLAY_EULER_TOUR_H
@@ -0,0 +1,113 @@
+#ifndef SPLAY_INTERVAL_H
+#define SPLAY_INTERVAL_H
+
+#include <algorithm>
+#include <compare>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "splay.h"
+
+// Set of half-open intervals [lo, hi) ordered by lo (ties by hi). Every subtree keeps the maximum hi it
+// contains, so queries skip subtrees that end before the query starts and stop at the first lo past its end.
+template<class T>
+class SplayIntervalTree {
+public:
+    struct Interval {
+        T lo, hi;
+
+        auto operator <=>(const Interval &) const = default;
+    };
+
+private:
+    using tree_t = SplayTree<Interval, std::less<Interval>, T>;
+
+    tree_t tree;
+
+    static typename tree_t::Function max_hi() {
+        return typename tree_t::Function([](const Interval &interval, const T &left, const T &right) {
+            return std::max({ interval.hi, left, right });
+        }, std::numeric_limits<T>::lowest());
+    }
+
+public:
+    SplayIntervalTree() : tree(max_hi()) {}
+
+    // Empty intervals and intervals already present are rejected.
+    bool insert(const T &lo, const T &hi) {
+        if (!(lo < hi)) {
+            return false;
+        }
+
+        size_t before = tree.size();
+        tree.insert(Interval { lo, hi });
+        return tree.size() != before;
+    }
+
+    bool erase(const T &lo, const T &hi) {
+        return tree.erase(Interval { lo, hi });
+    }
+
+    bool contains(const T &lo, const T &hi) {
+        return tree.contains(Interval { lo, hi });
+    }
+
+    // Calls f on every interval overlapping [lo, hi), in order of lo.
+    template<class F>
+    void for_each_overlapping(const T &lo, const T &hi, F f) {
+        if (!(lo < hi)) {
+            return;
+        }
+
+        tree.visit_if([&](const T &max_hi) { return lo < max_hi; }, [&](const Interval &interval) {
+            if (!(interval.lo < hi)) {
+                return false;
+            }
+            if (lo < interval.hi) {
+                f(interval);
+            }
+            return true;
+        });
+    }
+
+    // Calls f on every interval containing point, in order of lo.
+    template<class F>
+    void for_each_stabbing(const T &point, F f) {
+        tree.visit_if([&](const T &max_hi) { return point < max_hi; }, [&](const Interval &interval) {
+            if (point < interval.lo) {
+                return false;
+            }
+            if (point < interval.hi) {
+                f(interval);
+            }
+            return true;
+        });
+    }
+
+    std::vector<Interval> overlapping(const T &lo, const T &hi) {
+        std::vector<Interval> result;
+        for_each_overlapping(lo, hi, [&](const Interval &interval) { result.push_back(interval); });
+        return result;
+    }
+
+    std::vector<Interval> stabbing(const T &point) {
+        std::vector<Interval> result;
+        for_each_stabbing(point, [&](const Interval &interval) { result.push_back(interval); });
+        return result;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return tree.size();
+    }
+
+    [[nodiscard]] bool empty() const {
+        return tree.empty();
+    }
+
+    void clear() {
+        tree.clear();
+    }
+};
+
+#endif // SPLAY_INTERVAL_H
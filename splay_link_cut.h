@@ -0,0 +1,239 @@
+#ifndef SPLAY_LINK_CUT_H
+#define SPLAY_LINK_CUT_H
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "splay.h"
+#include "splay_engine.h"
+
+// Link-cut tree over a dynamic forest. Preferred paths are kept in splay trees ordered by depth, with lazy
+// reversal for rerooting. Path aggregates use the SplayTree::Function convention; the aggregate of the
+// reversed sequence is maintained as well, so non-commutative functions give results in path order.
+template<class T, class FunctionType = T>
+class LinkCutTree {
+public:
+    using Function = typename SplayTree<T, std::less<T>, FunctionType>::Function;
+    using vertex_t = std::uint32_t;
+
+private:
+    struct Vertex {
+        vertex_t left, right, parent;
+        bool reversed;
+        T value;
+        FunctionType function_value;
+        FunctionType reversed_function_value;
+    };
+
+    class Storage {
+        LinkCutTree *tree;
+
+    public:
+        using node_t = vertex_t;
+        static constexpr node_t nil = std::numeric_limits<vertex_t>::max();
+
+        explicit Storage(LinkCutTree *tree) : tree(tree) {}
+
+        vertex_t &left(vertex_t x) {
+            return tree->vertices[x].left;
+        }
+
+        vertex_t &right(vertex_t x) {
+            return tree->vertices[x].right;
+        }
+
+        vertex_t &parent(vertex_t x) {
+            return tree->vertices[x].parent;
+        }
+
+        void update(vertex_t x) {
+            tree->update(x);
+        }
+    };
+
+    using engine_t = SplayEngine<Storage>;
+
+    static constexpr vertex_t nil = Storage::nil;
+
+    std::vector<Vertex> vertices;
+    // Reused by splay() so pushing reversals down does not allocate.
+    std::vector<vertex_t> splay_path;
+    Function function;
+
+    Storage storage() {
+        return Storage(this);
+    }
+
+    FunctionType get_function_value(vertex_t x) const {
+        return x == nil ? function.get_default() : vertices[x].function_value;
+    }
+
+    FunctionType get_reversed_function_value(vertex_t x) const {
+        return x == nil ? function.get_default() : vertices[x].reversed_function_value;
+    }
+
+    void update(vertex_t x) {
+        if (function) {
+            Vertex &v = vertices[x];
+            v.function_value = function(v.value, get_function_value(v.left), get_function_value(v.right));
+            v.reversed_function_value = function(v.value, get_reversed_function_value(v.right),
+                                                 get_reversed_function_value(v.left));
+        }
+    }
+
+    void reverse(vertex_t x) {
+        if (x != nil) {
+            Vertex &v = vertices[x];
+            std::swap(v.left, v.right);
+            std::swap(v.function_value, v.reversed_function_value);
+            v.reversed = !v.reversed;
+        }
+    }
+
+    void push(vertex_t x) {
+        Vertex &v = vertices[x];
+        if (v.reversed) {
+            reverse(v.left);
+            reverse(v.right);
+            v.reversed = false;
+        }
+    }
+
+    void splay(vertex_t x) {
+        auto s = storage();
+
+        splay_path.clear();
+        splay_path.push_back(x);
+        while (!engine_t::is_root(s, splay_path.back())) {
+            splay_path.push_back(vertices[splay_path.back()].parent);
+        }
+        for (auto it = splay_path.rbegin(); it != splay_path.rend(); it++) {
+            push(*it);
+        }
+
+        engine_t::splay(s, x);
+    }
+
+    // Makes the root-to-x path preferred and splays x to the root of its auxiliary tree.
+    // Returns the last vertex where the path was switched, which is the LCA when called after access(u).
+    vertex_t access(vertex_t x) {
+        vertex_t last = nil;
+        for (vertex_t y = x; y != nil; y = vertices[y].parent) {
+            splay(y);
+            vertices[y].right = last;
+            update(y);
+            last = y;
+        }
+        splay(x);
+
+        return last;
+    }
+
+public:
+    explicit LinkCutTree(size_t n, const T &value = T(), Function function = Function()) : function(function) {
+        vertices.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            add_vertex(value);
+        }
+    }
+
+    vertex_t add_vertex(const T &value) {
+        vertex_t x = static_cast<vertex_t>(vertices.size());
+        vertices.push_back(Vertex { nil, nil, nil, false, value, function.get_default(), function.get_default() });
+        update(x);
+
+        return x;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return vertices.size();
+    }
+
+    void make_root(vertex_t x) {
+        access(x);
+        reverse(x);
+    }
+
+    vertex_t find_root(vertex_t x) {
+        access(x);
+        while (true) {
+            push(x);
+            if (vertices[x].left == nil) {
+                break;
+            }
+            x = vertices[x].left;
+        }
+        splay(x);
+
+        return x;
+    }
+
+    bool connected(vertex_t u, vertex_t v) {
+        return u == v || find_root(u) == find_root(v);
+    }
+
+    // Adds the edge (u, v). Fails if u and v are already connected.
+    bool link(vertex_t u, vertex_t v) {
+        if (connected(u, v)) {
+            return false;
+        }
+
+        make_root(u);
+        vertices[u].parent = v;
+
+        return true;
+    }
+
+    // Removes the edge (u, v). Fails if there is no such edge.
+    bool cut(vertex_t u, vertex_t v) {
+        make_root(u);
+        access(v);
+
+        Vertex &w = vertices[v];
+        if (w.left != u || vertices[u].right != nil) {
+            return false;
+        }
+
+        w.left = nil;
+        vertices[u].parent = nil;
+        update(v);
+
+        return true;
+    }
+
+    // Lowest common ancestor with respect to the current root of the tree.
+    std::optional<vertex_t> lca(vertex_t u, vertex_t v) {
+        if (!connected(u, v)) {
+            return std::nullopt;
+        }
+
+        access(u);
+        return access(v);
+    }
+
+    // Aggregate of the values on the path from u to v, in that order.
+    std::optional<FunctionType> path_function_value(vertex_t u, vertex_t v) {
+        if (!connected(u, v)) {
+            return std::nullopt;
+        }
+
+        make_root(u);
+        access(v);
+
+        return vertices[v].function_value;
+    }
+
+    const T &get_value(vertex_t x) const {
+        return vertices[x].value;
+    }
+
+    void set_value(vertex_t x, const T &value) {
+        access(x);
+        vertices[x].value = value;
+        update(x);
+    }
+};
+
+#endif // SPLAY_LINK_CUT_H
@@ -0,0 +1,420 @@
+#ifndef SPLAY_MAPPED_H
+#define SPLAY_MAPPED_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "splay.h"
+#include "splay_engine.h"
+
+// Splay tree whose nodes live in a memory-mapped file. Links are record indices, so the file can be
+// reopened by another process without any deserialization; rotations write straight into the mapping.
+// The header records the id of the Function the stored aggregates were computed with; opening with a
+// different id (or with id 0, meaning unknown) recomputes them.
+template<class V, Comparator<V> Comp = std::less<V>, class FunctionType = int>
+class MappedSplayTree {
+    static_assert(std::is_trivially_copyable_v<V>, "MappedSplayTree requires a trivially copyable value type");
+    static_assert(std::is_trivially_copyable_v<FunctionType>,
+                  "MappedSplayTree requires a trivially copyable function type");
+
+public:
+    using Function = typename SplayTree<V, Comp, FunctionType>::Function;
+    using index_t = std::uint64_t;
+
+private:
+    static constexpr std::uint64_t file_magic = 0x45455254594c5053; // "SPLYTREE"
+    static constexpr std::uint64_t file_version = 2;
+    static constexpr index_t initial_capacity = 64;
+
+    struct Header {
+        std::uint64_t magic;
+        std::uint64_t version;
+        std::uint64_t value_size;
+        std::uint64_t function_size;
+        index_t capacity;
+        index_t used;
+        index_t root;
+        index_t free_list;
+        std::uint64_t function_id;
+    };
+
+    struct Record {
+        index_t left, right, parent;
+        std::uint64_t subtree_size;
+        V value;
+        FunctionType function_value;
+    };
+
+    static constexpr size_t records_offset =
+            (sizeof(Header) + alignof(Record) - 1) / alignof(Record) * alignof(Record);
+
+    class Storage {
+        MappedSplayTree *tree;
+
+    public:
+        using node_t = index_t;
+        static constexpr node_t nil = ~index_t(0);
+
+        explicit Storage(MappedSplayTree *tree) : tree(tree) {}
+
+        index_t &left(index_t x) {
+            return tree->record(x).left;
+        }
+
+        index_t &right(index_t x) {
+            return tree->record(x).right;
+        }
+
+        index_t &parent(index_t x) {
+            return tree->record(x).parent;
+        }
+
+        void update(index_t x) {
+            tree->update(x);
+        }
+    };
+
+    using engine_t = SplayEngine<Storage>;
+
+    static constexpr index_t nil = Storage::nil;
+
+    int fd = -1;
+    std::byte *mapping = nullptr;
+    size_t mapping_size = 0;
+    Function function;
+
+    static size_t file_size_for(index_t capacity) {
+        return records_offset + capacity * sizeof(Record);
+    }
+
+    [[nodiscard]] static bool compare(const V &value1, const V &value2) {
+        return Comp{}(value1, value2);
+    }
+
+    [[noreturn]] static void fail(const char *what) {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    Header &header() const {
+        return *reinterpret_cast<Header *>(mapping);
+    }
+
+    Record &record(index_t x) const {
+        return reinterpret_cast<Record *>(mapping + records_offset)[x];
+    }
+
+    Storage storage() const {
+        return Storage(const_cast<MappedSplayTree *>(this));
+    }
+
+    // Maps size bytes of the file; the old mapping is only released once the new one exists.
+    void map(size_t size) {
+        void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            fail("mmap");
+        }
+        unmap();
+        mapping = static_cast<std::byte *>(address);
+        mapping_size = size;
+    }
+
+    void unmap() {
+        if (mapping != nullptr) {
+            munmap(mapping, mapping_size);
+            mapping = nullptr;
+            mapping_size = 0;
+        }
+    }
+
+    void grow() {
+        index_t capacity = header().capacity * 2;
+        size_t size = file_size_for(capacity);
+
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            fail("ftruncate");
+        }
+        map(size);
+        header().capacity = capacity;
+    }
+
+    void update(index_t x) {
+        Record &r = record(x);
+        r.subtree_size = 1 + get_subtree_size(r.left) + get_subtree_size(r.right);
+        if (function) {
+            r.function_value = function(r.value, get_function_value(r.left), get_function_value(r.right));
+        }
+    }
+
+    [[nodiscard]] std::uint64_t get_subtree_size(index_t x) const {
+        return x == nil ? 0 : record(x).subtree_size;
+    }
+
+    FunctionType get_function_value(index_t x) const {
+        return x == nil ? function.get_default() : record(x).function_value;
+    }
+
+    index_t allocate(const V &value) {
+        index_t x = header().free_list;
+        if (x != nil) {
+            header().free_list = record(x).left;
+        }
+        else {
+            if (header().used == header().capacity) {
+                grow();
+            }
+            x = header().used++;
+        }
+
+        Record &r = record(x);
+        r.left = r.right = r.parent = nil;
+        r.value = value;
+        update(x);
+
+        return x;
+    }
+
+    void deallocate(index_t x) {
+        record(x).left = header().free_list;
+        header().free_list = x;
+    }
+
+    std::pair<index_t, int> descend(const V &value) const {
+        auto s = storage();
+        return engine_t::descend(s, header().root, [&](index_t x) {
+            const V &current = record(x).value;
+            return compare(value, current) ? -1 : compare(current, value) ? 1 : 0;
+        });
+    }
+
+    void recompute_function_values() {
+        std::vector<index_t> order;
+        std::vector<index_t> stack;
+        if (header().root != nil) {
+            stack.push_back(header().root);
+        }
+
+        while (!stack.empty()) {
+            index_t x = stack.back();
+            stack.pop_back();
+            order.push_back(x);
+            for (index_t child : { record(x).left, record(x).right }) {
+                if (child != nil) {
+                    stack.push_back(child);
+                }
+            }
+        }
+
+        for (auto it = order.rbegin(); it != order.rend(); it++) {
+            update(*it);
+        }
+    }
+
+    void splay(index_t x) {
+        auto s = storage();
+        engine_t::splay(s, x);
+        header().root = x;
+    }
+
+    void open_mapping(const std::string &path, std::uint64_t function_id) {
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            fail("fstat");
+        }
+
+        if (st.st_size == 0) {
+            size_t size = file_size_for(initial_capacity);
+            if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+                fail("ftruncate");
+            }
+            map(size);
+            header() = { file_magic, file_version, sizeof(V), sizeof(FunctionType), initial_capacity, 0, nil, nil, 0 };
+        }
+        else {
+            map(static_cast<size_t>(st.st_size));
+            const Header &h = header();
+            if (mapping_size < sizeof(Header) || h.magic != file_magic || h.version != file_version
+                || h.value_size != sizeof(V) || h.function_size != sizeof(FunctionType)
+                || file_size_for(h.capacity) > mapping_size) {
+                throw std::runtime_error("MappedSplayTree: '" + path + "' is not a compatible tree file");
+            }
+        }
+
+        if (function && (function_id == 0 || header().function_id != function_id)) {
+            recompute_function_values();
+        }
+        header().function_id = function ? function_id : 0;
+    }
+
+public:
+    class Iterator {
+        const MappedSplayTree *tree = nullptr;
+        index_t index = nil;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = V;
+        using pointer = const V *;
+        using reference = const V &;
+
+        Iterator() = default;
+
+        Iterator(const MappedSplayTree *tree, index_t index) : tree(tree), index(index) {}
+
+        bool operator==(const Iterator &other) const {
+            return index == other.index;
+        }
+
+        reference operator*() const {
+            return tree->record(index).value;
+        }
+
+        pointer operator->() const {
+            return &tree->record(index).value;
+        }
+
+        Iterator &operator++() {
+            auto s = tree->storage();
+            index = engine_t::next(s, index);
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator temp = *this;
+            ++*this;
+            return temp;
+        }
+    };
+
+    // function_id identifies function across runs; pass a new id whenever the Function changes.
+    explicit MappedSplayTree(const std::string &path, Function function = Function(), std::uint64_t function_id = 0)
+            : function(function) {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            fail("open");
+        }
+
+        try {
+            open_mapping(path, function_id);
+        } catch (...) {
+            unmap();
+            ::close(fd);
+            throw;
+        }
+    }
+
+    MappedSplayTree(const MappedSplayTree &) = delete;
+
+    MappedSplayTree &operator =(const MappedSplayTree &) = delete;
+
+    MappedSplayTree(MappedSplayTree &&other) noexcept
+            : fd(std::exchange(other.fd, -1)), mapping(std::exchange(other.mapping, nullptr)),
+              mapping_size(std::exchange(other.mapping_size, 0)), function(other.function) {}
+
+    ~MappedSplayTree() {
+        unmap();
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    Iterator begin() const {
+        auto s = storage();
+        return Iterator(this, engine_t::first(s, header().root));
+    }
+
+    Iterator end() const {
+        return Iterator(this, nil);
+    }
+
+    bool insert(const V &value) {
+        auto [node, dir] = descend(value);
+
+        if (node != nil && dir == 0) {
+            splay(node);
+            return false;
+        }
+
+        index_t x = allocate(value);
+        if (node != nil) {
+            auto s = storage();
+            engine_t::attach(s, node, x, dir);
+        }
+        splay(x);
+
+        return true;
+    }
+
+    bool contains(const V &value) {
+        auto [node, dir] = descend(value);
+        if (node == nil) {
+            return false;
+        }
+
+        splay(node);
+        return dir == 0;
+    }
+
+    bool contains(const V &value) const {
+        auto [node, dir] = descend(value);
+        return node != nil && dir == 0;
+    }
+
+    Iterator find(const V &value) {
+        return contains(value) ? Iterator(this, header().root) : end();
+    }
+
+    bool erase(const V &value) {
+        if (!contains(value)) {
+            return false;
+        }
+
+        index_t x = header().root;
+        auto s = storage();
+        index_t new_root = engine_t::remove_root(s, x);
+        if (new_root != nil) {
+            record(new_root).parent = nil;
+        }
+        header().root = new_root;
+        deallocate(x);
+
+        return true;
+    }
+
+    void clear() {
+        header().root = nil;
+        header().used = 0;
+        header().free_list = nil;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return get_subtree_size(header().root);
+    }
+
+    [[nodiscard]] bool empty() const {
+        return header().root == nil;
+    }
+
+    FunctionType get_function_value() const {
+        return get_function_value(header().root);
+    }
+
+    void sync() const {
+        if (msync(mapping, mapping_size, MS_SYNC) != 0) {
+            fail("msync");
+        }
+    }
+};
+
+#endif // SPLAY_MAPPED_H
@@ -0,0 +1,304 @@
+#ifndef SPLAY_QUEUE_H
+#define SPLAY_QUEUE_H
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "splay.h"
+#include "splay_engine.h"
+
+// Double-ended priority queue on a splay tree of individually allocated nodes. The minimum and maximum are
+// cached, so reading them is O(1) and popping splays the extreme node directly. push returns a handle that
+// stays valid until the element is popped or cancelled, also across meld. Equal priorities pop in FIFO order
+// from both ends.
+template<class T, Comparator<T> Comp = std::less<T>>
+class SplayQueue {
+    struct Node {
+        Node *left, *right, *parent;
+        T value;
+    };
+
+    class Storage {
+    public:
+        using node_t = Node *;
+        static constexpr node_t nil = nullptr;
+
+        Node *&left(Node *x) {
+            return x->left;
+        }
+
+        Node *&right(Node *x) {
+            return x->right;
+        }
+
+        Node *&parent(Node *x) {
+            return x->parent;
+        }
+
+        void update(Node *) {}
+    };
+
+    using engine_t = SplayEngine<Storage>;
+
+    Node *root = nullptr;
+    Node *min_node = nullptr;
+    Node *max_node = nullptr;
+    size_t count = 0;
+
+    [[nodiscard]] static bool compare(const T &value1, const T &value2) {
+        return Comp{}(value1, value2);
+    }
+
+    void splay(Node *x) {
+        Storage s;
+        engine_t::splay(s, x);
+        root = x;
+    }
+
+    // Links a detached node into the tree, after all elements with an equal priority.
+    void link(Node *x) {
+        x->left = x->right = x->parent = nullptr;
+        count++;
+
+        if (root == nullptr) {
+            root = min_node = max_node = x;
+            return;
+        }
+
+        if (compare(x->value, min_node->value)) {
+            min_node = x;
+        }
+        if (compare(max_node->value, x->value)) {
+            max_node = x;
+        }
+
+        Storage s;
+        auto [parent, dir] = engine_t::descend(s, root, [&](Node *y) {
+            return compare(x->value, y->value) ? -1 : 1;
+        });
+        engine_t::attach(s, parent, x, dir);
+        splay(x);
+    }
+
+    // Unlinks x from the tree without freeing it.
+    void unlink(Node *x) {
+        Storage s;
+        splay(x);
+        root = engine_t::remove_root(s, x);
+        if (root != nullptr) {
+            root->parent = nullptr;
+        }
+        count--;
+
+        if (x == min_node) {
+            min_node = engine_t::first(s, root);
+        }
+        if (x == max_node) {
+            max_node = oldest_max();
+        }
+    }
+
+    // First node of the run of priorities equal to the maximum, i.e. the one pushed earliest.
+    Node *oldest_max() {
+        Storage s;
+        Node *last = engine_t::last(s, root);
+        if (last == nullptr) {
+            return nullptr;
+        }
+
+        Node *result = last;
+        for (Node *x = root; x != nullptr;) {
+            if (compare(x->value, last->value)) {
+                x = x->right;
+            }
+            else {
+                result = x;
+                x = x->left;
+            }
+        }
+        splay(result);
+
+        return result;
+    }
+
+    T pop(Node *x) {
+        unlink(x);
+        T value = std::move(x->value);
+        delete x;
+
+        return value;
+    }
+
+    void reset() {
+        root = min_node = max_node = nullptr;
+        count = 0;
+    }
+
+    template<class F>
+    static void for_each_node(Node *root, F f) {
+        std::vector<Node *> stack;
+        if (root != nullptr) {
+            stack.push_back(root);
+        }
+
+        while (!stack.empty()) {
+            Node *x = stack.back();
+            stack.pop_back();
+            if (x->left != nullptr) {
+                stack.push_back(x->left);
+            }
+            if (x->right != nullptr) {
+                stack.push_back(x->right);
+            }
+            f(x);
+        }
+    }
+
+public:
+    class handle {
+        friend class SplayQueue;
+
+        Node *node = nullptr;
+
+        explicit handle(Node *node) : node(node) {}
+
+    public:
+        handle() = default;
+
+        explicit operator bool() const {
+            return node != nullptr;
+        }
+
+        bool operator ==(const handle &) const = default;
+    };
+
+    SplayQueue() = default;
+
+    SplayQueue(const SplayQueue &) = delete;
+
+    SplayQueue &operator =(const SplayQueue &) = delete;
+
+    SplayQueue(SplayQueue &&other) noexcept
+            : root(other.root), min_node(other.min_node), max_node(other.max_node), count(other.count) {
+        other.reset();
+    }
+
+    SplayQueue &operator =(SplayQueue &&other) noexcept {
+        if (this != &other) {
+            clear();
+            root = other.root;
+            min_node = other.min_node;
+            max_node = other.max_node;
+            count = other.count;
+            other.reset();
+        }
+
+        return *this;
+    }
+
+    ~SplayQueue() {
+        clear();
+    }
+
+    handle push(T value) {
+        Node *x = new Node { nullptr, nullptr, nullptr, std::move(value) };
+        link(x);
+
+        return handle(x);
+    }
+
+    const T &min() const {
+        return min_node->value;
+    }
+
+    const T &max() const {
+        return max_node->value;
+    }
+
+    T pop_min() {
+        return pop(min_node);
+    }
+
+    T pop_max() {
+        return pop(max_node);
+    }
+
+    const T &get(handle h) const {
+        return h.node->value;
+    }
+
+    // Removes the element of h and invalidates h.
+    T cancel(handle h) {
+        return pop(h.node);
+    }
+
+    // Changes the priority of the element of h; h stays valid. The element goes after equal priorities.
+    void reschedule(handle h, T value) {
+        unlink(h.node);
+        h.node->value = std::move(value);
+        link(h.node);
+    }
+
+    // Moves all elements of other into this queue, leaving other empty; handles into other stay valid here.
+    // If one queue precedes the other entirely the trees are joined, otherwise the smaller one is relinked
+    // node by node in order. Elements of other pop after equal priorities of this queue, except in the
+    // relinking case when other is the larger queue, where this queue's elements go after other's.
+    void meld(SplayQueue &other) {
+        if (this == &other || other.empty()) {
+            return;
+        }
+        if (empty()) {
+            std::swap(*this, other);
+            return;
+        }
+
+        Storage s;
+        if (!compare(other.min_node->value, max_node->value)) {
+            root = engine_t::join(s, root, other.root);
+            if (compare(max_node->value, other.max_node->value)) {
+                max_node = other.max_node;
+            }
+            count += other.count;
+        }
+        else if (compare(other.max_node->value, min_node->value)) {
+            root = engine_t::join(s, other.root, root);
+            min_node = other.min_node;
+            count += other.count;
+        }
+        else {
+            if (other.count > count) {
+                std::swap(root, other.root);
+                std::swap(min_node, other.min_node);
+                std::swap(max_node, other.max_node);
+                std::swap(count, other.count);
+            }
+
+            std::vector<Node *> nodes;
+            nodes.reserve(other.count);
+            for (Node *x = engine_t::first(s, other.root); x != nullptr; x = engine_t::next(s, x)) {
+                nodes.push_back(x);
+            }
+            for (Node *x : nodes) {
+                link(x);
+            }
+        }
+
+        other.reset();
+    }
+
+    [[nodiscard]] size_t size() const {
+        return count;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return count == 0;
+    }
+
+    void clear() {
+        for_each_node(root, [](Node *x) { delete x; });
+        reset();
+    }
+};
+
+#endif // SPLAY_QUEUE_H
@@ -0,0 +1,243 @@
+#ifndef SPLAY_SMALL_H
+#define SPLAY_SMALL_H
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "splay.h"
+
+// Set that keeps up to Threshold values in an inline sorted array and switches to a SplayTree past that. It
+// switches back once the tree shrinks to Threshold / 2, so a size hovering around the threshold does not
+// convert on every operation. The function value of the array is computed over the balanced tree of its
+// values and cached until the next change.
+template<class V, Comparator<V> Comp = std::less<V>, class FunctionType = int, size_t Threshold = 32>
+        requires std::default_initializable<V>
+class SmallSplayTree {
+    static_assert(Threshold >= 2, "SmallSplayTree needs a threshold of at least 2");
+
+public:
+    using tree_t = SplayTree<V, Comp, FunctionType>;
+    using Function = typename tree_t::Function;
+
+private:
+    using tree_iterator_t = decltype(std::declval<const tree_t &>().begin());
+
+    std::array<V, Threshold> values{};
+    size_t count = 0;
+    std::unique_ptr<tree_t> tree;
+
+    Function function;
+    Comp comp{};
+    mutable std::optional<FunctionType> small_function_value;
+
+    [[nodiscard]] bool compare(const V &value1, const V &value2) const {
+        return comp(value1, value2);
+    }
+
+    // Position of the first value not less than value, without data-dependent branches.
+    [[nodiscard]] size_t lower_bound_index(const V &value) const {
+        const V *base = values.data();
+        size_t length = count;
+        while (length > 1) {
+            size_t half = length / 2;
+            base = compare(base[half - 1], value) ? base + half : base;
+            length -= half;
+        }
+        return (base - values.data()) + (length == 1 && compare(*base, value));
+    }
+
+    [[nodiscard]] bool found_at(size_t index, const V &value) const {
+        return index < count && !compare(value, values[index]);
+    }
+
+    FunctionType balanced_function_value(size_t begin, size_t end) const {
+        if (begin == end) {
+            return function.get_default();
+        }
+        size_t middle = begin + (end - begin) / 2;
+        return function(values[middle], balanced_function_value(begin, middle),
+                        balanced_function_value(middle + 1, end));
+    }
+
+    void grow() {
+        std::vector<V> sorted(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(count));
+        tree = std::make_unique<tree_t>(tree_t::from_sorted(sorted, function, 1, comp));
+        count = 0;
+    }
+
+    void shrink() {
+        count = 0;
+        for (const V &value : *tree) {
+            values[count++] = value;
+        }
+        tree = nullptr;
+        small_function_value.reset();
+    }
+
+public:
+    class Iterator {
+        std::variant<const V *, tree_iterator_t> position;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = V;
+        using pointer = const V *;
+        using reference = const V &;
+
+        explicit Iterator(const V *position) : position(position) {}
+
+        explicit Iterator(tree_iterator_t position) : position(position) {}
+
+        bool operator ==(const Iterator &other) const {
+            return position == other.position;
+        }
+
+        const V &operator *() const {
+            return std::holds_alternative<const V *>(position) ? *std::get<const V *>(position)
+                                                             : *std::get<tree_iterator_t>(position);
+        }
+
+        const V *operator ->() const {
+            return &**this;
+        }
+
+        Iterator &operator ++() {
+            if (std::holds_alternative<const V *>(position)) {
+                std::get<const V *>(position)++;
+            }
+            else {
+                ++std::get<tree_iterator_t>(position);
+            }
+            return *this;
+        }
+
+        Iterator operator ++(int) {
+            Iterator temp = *this;
+            ++*this;
+            return temp;
+        }
+    };
+
+    SmallSplayTree() = default;
+
+    explicit SmallSplayTree(Function function) : function(function) {}
+
+    explicit SmallSplayTree(Comp comp, Function function = Function()) : function(function), comp(comp) {}
+
+    SmallSplayTree(std::initializer_list<V> values, Function function = Function()) : function(function) {
+        for (const V &value : values) {
+            insert(value);
+        }
+    }
+
+    bool insert(const V &value) {
+        if (tree != nullptr) {
+            size_t before = tree->size();
+            tree->insert(value);
+            return tree->size() != before;
+        }
+
+        size_t index = lower_bound_index(value);
+        if (found_at(index, value)) {
+            return false;
+        }
+        if (count == Threshold) {
+            grow();
+            tree->insert(value);
+            return true;
+        }
+
+        std::move_backward(values.begin() + static_cast<std::ptrdiff_t>(index),
+                           values.begin() + static_cast<std::ptrdiff_t>(count),
+                           values.begin() + static_cast<std::ptrdiff_t>(count + 1));
+        values[index] = value;
+        count++;
+        small_function_value.reset();
+
+        return true;
+    }
+
+    bool contains(const V &value) {
+        return tree != nullptr ? tree->contains(value) : found_at(lower_bound_index(value), value);
+    }
+
+    [[nodiscard]] bool contains(const V &value) const {
+        return tree != nullptr ? std::as_const(*tree).contains(value) : found_at(lower_bound_index(value), value);
+    }
+
+    bool erase(const V &value) {
+        if (tree != nullptr) {
+            if (!tree->erase(value)) {
+                return false;
+            }
+            if (tree->size() <= Threshold / 2) {
+                shrink();
+            }
+            return true;
+        }
+
+        size_t index = lower_bound_index(value);
+        if (!found_at(index, value)) {
+            return false;
+        }
+
+        std::move(values.begin() + static_cast<std::ptrdiff_t>(index + 1),
+                  values.begin() + static_cast<std::ptrdiff_t>(count),
+                  values.begin() + static_cast<std::ptrdiff_t>(index));
+        count--;
+        small_function_value.reset();
+
+        return true;
+    }
+
+    Iterator begin() const {
+        return tree != nullptr ? Iterator(tree->begin()) : Iterator(values.data());
+    }
+
+    Iterator end() const {
+        return tree != nullptr ? Iterator(tree->end()) : Iterator(values.data() + count);
+    }
+
+    FunctionType get_function_value() const {
+        if (tree != nullptr) {
+            return tree->get_function_value();
+        }
+        if (!function) {
+            return FunctionType();
+        }
+        if (!small_function_value) {
+            small_function_value = balanced_function_value(0, count);
+        }
+        return *small_function_value;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return tree != nullptr ? tree->size() : count;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return size() == 0;
+    }
+
+    // Whether the values are in the inline array.
+    [[nodiscard]] bool is_small() const {
+        return tree == nullptr;
+    }
+
+    void clear() {
+        tree = nullptr;
+        count = 0;
+        small_function_value.reset();
+    }
+};
+
+#endif // SPLAY_SMALL_H
@@ -0,0 +1,315 @@
+#ifndef SPLAY_STRING_H
+#define SPLAY_STRING_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <ranges>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "splay_engine.h"
+
+// Set of strings on a splay tree, ordered like std::string. Keys up to InlineCapacity bytes are stored inside
+// the node. A descent remembers how many leading bytes the key shares with the nearest smaller and larger
+// nodes passed so far; every node below lies between the two, so its comparison starts after the shorter one.
+template<size_t InlineCapacity = 24>
+class StringSplayTree {
+    using index_t = std::uint32_t;
+
+    struct Node {
+        index_t left, right, parent;
+        std::uint32_t length;
+        std::array<char, InlineCapacity> inline_chars;
+        std::unique_ptr<char[]> heap_chars;
+
+        [[nodiscard]] std::string_view key() const {
+            return { length <= InlineCapacity ? inline_chars.data() : heap_chars.get(), length };
+        }
+
+        void set_key(std::string_view key) {
+            length = static_cast<std::uint32_t>(key.size());
+            if (key.size() <= InlineCapacity) {
+                heap_chars = nullptr;
+                std::memcpy(inline_chars.data(), key.data(), key.size());
+            }
+            else {
+                heap_chars = std::make_unique<char[]>(key.size());
+                std::memcpy(heap_chars.get(), key.data(), key.size());
+            }
+        }
+    };
+
+    class Storage {
+        StringSplayTree *tree;
+
+    public:
+        using node_t = index_t;
+        static constexpr node_t nil = std::numeric_limits<index_t>::max();
+
+        explicit Storage(StringSplayTree *tree) : tree(tree) {}
+
+        index_t &left(index_t x) {
+            return tree->nodes[x].left;
+        }
+
+        index_t &right(index_t x) {
+            return tree->nodes[x].right;
+        }
+
+        index_t &parent(index_t x) {
+            return tree->nodes[x].parent;
+        }
+
+        void update(index_t) {}
+    };
+
+    using engine_t = SplayEngine<Storage>;
+
+    static constexpr index_t nil = Storage::nil;
+
+    std::vector<Node> nodes;
+    index_t root = nil;
+    index_t free_list = nil;
+    size_t count = 0;
+
+    Storage storage() const {
+        return Storage(const_cast<StringSplayTree *>(this));
+    }
+
+    // Compares key with other, both known to agree on their first skip bytes. Returns the sign of the
+    // comparison and the length of the common prefix.
+    static std::pair<int, size_t> compare_from(std::string_view key, std::string_view other, size_t skip) {
+        size_t length = std::min(key.size(), other.size());
+        auto [mismatch, _] = std::mismatch(key.begin() + skip, key.begin() + length, other.begin() + skip);
+        size_t common = mismatch - key.begin();
+
+        if (common == length) {
+            return { key.size() < other.size() ? -1 : key.size() > other.size() ? 1 : 0, common };
+        }
+        return { static_cast<unsigned char>(key[common]) < static_cast<unsigned char>(other[common]) ? -1 : 1,
+                 common };
+    }
+
+    // Descends towards key with prefix skipping. Returns the last node visited and the last direction.
+    std::pair<index_t, int> descend(std::string_view key) const {
+        auto s = storage();
+        size_t lower_common = 0, upper_common = 0;
+
+        return engine_t::descend(s, root, [&](index_t x) {
+            auto [dir, common] = compare_from(key, nodes[x].key(), std::min(lower_common, upper_common));
+            (dir < 0 ? upper_common : lower_common) = common;
+            return dir;
+        });
+    }
+
+    void splay(index_t x) {
+        auto s = storage();
+        engine_t::splay(s, x);
+        root = x;
+    }
+
+    // First node whose key is not less than key, or nil; splays the last visited node.
+    index_t lower_bound_node(std::string_view key) {
+        auto [x, dir] = descend(key);
+        if (x == nil) {
+            return nil;
+        }
+
+        splay(x);
+        if (dir > 0) {
+            auto s = storage();
+            return engine_t::next(s, x);
+        }
+        return x;
+    }
+
+    // First node after all keys starting with prefix, or nil; splays the last visited node.
+    index_t prefix_end_node(std::string_view prefix) {
+        auto s = storage();
+        auto [x, dir] = engine_t::descend(s, root, [&](index_t y) {
+            std::string_view key = nodes[y].key();
+            return key.starts_with(prefix) || key < prefix ? 1 : -1;
+        });
+        if (x == nil) {
+            return nil;
+        }
+
+        splay(x);
+        return dir < 0 ? x : engine_t::next(s, x);
+    }
+
+public:
+    class Iterator {
+        friend class StringSplayTree;
+
+        const StringSplayTree *tree = nullptr;
+        index_t node = nil;
+
+        Iterator(const StringSplayTree *tree, index_t node) : tree(tree), node(node) {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = std::string_view;
+        using pointer = const std::string_view *;
+        using reference = std::string_view;
+
+        Iterator() = default;
+
+        bool operator ==(const Iterator &other) const {
+            return node == other.node;
+        }
+
+        std::string_view operator *() const {
+            return tree->nodes[node].key();
+        }
+
+        Iterator &operator ++() {
+            auto s = tree->storage();
+            node = engine_t::next(s, node);
+            return *this;
+        }
+
+        Iterator operator ++(int) {
+            Iterator temp = *this;
+            ++*this;
+            return temp;
+        }
+    };
+
+    class Range : public std::ranges::view_interface<Range> {
+        Iterator first, last;
+
+    public:
+        Range() = default;
+
+        Range(Iterator first, Iterator last) : first(first), last(last) {}
+
+        Iterator begin() const {
+            return first;
+        }
+
+        Iterator end() const {
+            return last;
+        }
+    };
+
+    StringSplayTree() = default;
+
+    StringSplayTree(std::initializer_list<std::string_view> keys) {
+        for (auto key : keys) {
+            insert(key);
+        }
+    }
+
+    bool insert(std::string_view key) {
+        auto [x, dir] = descend(key);
+        if (x != nil && dir == 0) {
+            splay(x);
+            return false;
+        }
+
+        index_t y;
+        if (free_list != nil) {
+            y = free_list;
+            free_list = nodes[y].left;
+        }
+        else {
+            y = static_cast<index_t>(nodes.size());
+            nodes.emplace_back();
+        }
+
+        Node &node = nodes[y];
+        node.left = node.right = node.parent = nil;
+        node.set_key(key);
+        if (x != nil) {
+            auto s = storage();
+            engine_t::attach(s, x, y, dir);
+        }
+        splay(y);
+        count++;
+
+        return true;
+    }
+
+    bool contains(std::string_view key) {
+        auto [x, dir] = descend(key);
+        if (x == nil) {
+            return false;
+        }
+
+        splay(x);
+        return dir == 0;
+    }
+
+    [[nodiscard]] bool contains(std::string_view key) const {
+        auto [x, dir] = descend(key);
+        return x != nil && dir == 0;
+    }
+
+    bool erase(std::string_view key) {
+        auto [x, dir] = descend(key);
+        if (x == nil) {
+            return false;
+        }
+
+        splay(x);
+        if (dir != 0) {
+            return false;
+        }
+
+        auto s = storage();
+        root = engine_t::remove_root(s, x);
+        if (root != nil) {
+            nodes[root].parent = nil;
+        }
+
+        nodes[x].heap_chars = nullptr;
+        nodes[x].left = free_list;
+        free_list = x;
+        count--;
+
+        return true;
+    }
+
+    // Keys starting with prefix, in order. Valid until the tree is modified.
+    Range prefix_range(std::string_view prefix) {
+        index_t first = lower_bound_node(prefix);
+        if (first == nil || !nodes[first].key().starts_with(prefix)) {
+            return Range(end(), end());
+        }
+        return Range(Iterator(this, first), Iterator(this, prefix_end_node(prefix)));
+    }
+
+    Iterator begin() const {
+        auto s = storage();
+        return Iterator(this, engine_t::first(s, root));
+    }
+
+    Iterator end() const {
+        return Iterator(this, nil);
+    }
+
+    [[nodiscard]] size_t size() const {
+        return count;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return count == 0;
+    }
+
+    void clear() {
+        nodes.clear();
+        root = free_list = nil;
+        count = 0;
+    }
+};
+
+#endif // SPLAY_STRING_H
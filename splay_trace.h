@@ -0,0 +1,80 @@
+#ifndef SPLAY_TRACE_H
+#define SPLAY_TRACE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "splay.h"
+
+// Compact binary access trace: a header followed by one (operation byte, raw value) record per operation.
+namespace splay_trace {
+    constexpr char magic[4] = { 'S', 'P', 'L', 'T' };
+    constexpr std::uint8_t version = 1;
+
+    struct Header {
+        char magic[4];
+        std::uint8_t version;
+        std::uint8_t value_size;
+    };
+}
+
+template<class V>
+class TraceWriter {
+    static_assert(std::is_trivially_copyable_v<V>, "TraceWriter requires a trivially copyable value type");
+
+    std::ostream &out;
+
+public:
+    explicit TraceWriter(std::ostream &out) : out(out) {
+        splay_trace::Header header = { { 'S', 'P', 'L', 'T' }, splay_trace::version, sizeof(V) };
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+
+    void write(TraceOperation operation, const V &value) {
+        out.put(static_cast<char>(operation));
+        out.write(reinterpret_cast<const char *>(&value), sizeof(V));
+    }
+
+    auto hook() {
+        return [this](TraceOperation operation, const V &value) { write(operation, value); };
+    }
+};
+
+template<class V>
+class TraceReader {
+    static_assert(std::is_trivially_copyable_v<V>, "TraceReader requires a trivially copyable value type");
+
+    std::istream &in;
+
+public:
+    static std::uint8_t value_size(std::istream &in) {
+        splay_trace::Header header{};
+        if (!in.read(reinterpret_cast<char *>(&header), sizeof(header))
+            || !std::equal(header.magic, header.magic + 4, splay_trace::magic)
+            || header.version != splay_trace::version) {
+            throw std::runtime_error("TraceReader: not a splay trace");
+        }
+        return header.value_size;
+    }
+
+    // Expects the header to have been consumed by value_size().
+    explicit TraceReader(std::istream &in) : in(in) {}
+
+    std::optional<std::pair<TraceOperation, V>> next() {
+        int operation = in.get();
+        V value;
+        if (operation == std::istream::traits_type::eof()
+            || !in.read(reinterpret_cast<char *>(&value), sizeof(V))) {
+            return std::nullopt;
+        }
+        return std::make_pair(static_cast<TraceOperation>(operation), value);
+    }
+};
+
+#endif // SPLAY_TRACE_H
@@ -0,0 +1,239 @@
+#ifndef STATIC_SPLAY_H
+#define STATIC_SPLAY_H
+
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "splay_concepts.h"
+#include "splay_engine.h"
+
+// Splay tree set with room for N values stored inline; it never allocates and every operation can be used
+// in constant expressions. Links are the smallest unsigned type that can index N nodes.
+template<class V, size_t N, Comparator<V> Comp = std::less<V>> requires std::default_initializable<V>
+class StaticSplayTree {
+    static_assert(N > 0, "StaticSplayTree needs a positive capacity");
+
+    using index_t = std::conditional_t<(N < std::numeric_limits<std::uint8_t>::max()), std::uint8_t,
+            std::conditional_t<(N < std::numeric_limits<std::uint16_t>::max()), std::uint16_t, std::uint32_t>>;
+
+    struct Node {
+        index_t left, right, parent;
+        V value;
+    };
+
+    class Storage {
+        StaticSplayTree *tree;
+
+    public:
+        using node_t = index_t;
+        static constexpr node_t nil = std::numeric_limits<index_t>::max();
+
+        constexpr explicit Storage(StaticSplayTree *tree) : tree(tree) {}
+
+        constexpr index_t &left(index_t x) {
+            return tree->nodes[x].left;
+        }
+
+        constexpr index_t &right(index_t x) {
+            return tree->nodes[x].right;
+        }
+
+        constexpr index_t &parent(index_t x) {
+            return tree->nodes[x].parent;
+        }
+
+        constexpr void update(index_t) {}
+    };
+
+    using engine_t = SplayEngine<Storage>;
+
+    static constexpr index_t nil = Storage::nil;
+
+    std::array<Node, N> nodes{};
+    index_t root = nil;
+    index_t free_list = nil;
+    index_t used = 0;
+    index_t count = 0;
+
+    [[nodiscard]] static constexpr bool compare(const V &value1, const V &value2) {
+        return Comp{}(value1, value2);
+    }
+
+    constexpr Storage storage() const {
+        return Storage(const_cast<StaticSplayTree *>(this));
+    }
+
+    constexpr std::pair<index_t, int> descend(const V &value) const {
+        auto s = storage();
+        return engine_t::descend(s, root, [&](index_t x) {
+            return compare(value, nodes[x].value) ? -1 : compare(nodes[x].value, value) ? 1 : 0;
+        });
+    }
+
+    constexpr void splay(index_t x) {
+        auto s = storage();
+        engine_t::splay(s, x);
+        root = x;
+    }
+
+public:
+    class Iterator {
+        friend class StaticSplayTree;
+
+        const StaticSplayTree *tree = nullptr;
+        index_t node = nil;
+
+        constexpr Iterator(const StaticSplayTree *tree, index_t node) : tree(tree), node(node) {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = V;
+        using pointer = const V *;
+        using reference = const V &;
+
+        constexpr Iterator() = default;
+
+        constexpr bool operator ==(const Iterator &other) const {
+            return node == other.node;
+        }
+
+        constexpr const V &operator *() const {
+            return tree->nodes[node].value;
+        }
+
+        constexpr const V *operator ->() const {
+            return &tree->nodes[node].value;
+        }
+
+        constexpr Iterator &operator ++() {
+            auto s = tree->storage();
+            node = engine_t::next(s, node);
+            return *this;
+        }
+
+        constexpr Iterator operator ++(int) {
+            Iterator temp = *this;
+            ++*this;
+            return temp;
+        }
+    };
+
+    constexpr StaticSplayTree() = default;
+
+    constexpr StaticSplayTree(std::initializer_list<V> values) {
+        for (const V &value : values) {
+            insert(value);
+        }
+    }
+
+    // Returns false if the value is already present; throws std::length_error if the tree is full.
+    constexpr bool insert(const V &value) {
+        auto [x, dir] = descend(value);
+        if (x != nil && dir == 0) {
+            splay(x);
+            return false;
+        }
+
+        index_t y;
+        if (free_list != nil) {
+            y = free_list;
+            free_list = nodes[y].left;
+        }
+        else if (used < N) {
+            y = used++;
+        }
+        else {
+            throw std::length_error("StaticSplayTree: capacity exceeded");
+        }
+
+        nodes[y] = Node { nil, nil, nil, value };
+        if (x != nil) {
+            auto s = storage();
+            engine_t::attach(s, x, y, dir);
+        }
+        splay(y);
+        count++;
+
+        return true;
+    }
+
+    constexpr bool contains(const V &value) {
+        auto [x, dir] = descend(value);
+        if (x == nil) {
+            return false;
+        }
+
+        splay(x);
+        return dir == 0;
+    }
+
+    [[nodiscard]] constexpr bool contains(const V &value) const {
+        auto [x, dir] = descend(value);
+        return x != nil && dir == 0;
+    }
+
+    constexpr bool erase(const V &value) {
+        auto [x, dir] = descend(value);
+        if (x == nil) {
+            return false;
+        }
+
+        splay(x);
+        if (dir != 0) {
+            return false;
+        }
+
+        auto s = storage();
+        root = engine_t::remove_root(s, x);
+        if (root != nil) {
+            nodes[root].parent = nil;
+        }
+
+        nodes[x].left = free_list;
+        free_list = x;
+        count--;
+
+        return true;
+    }
+
+    constexpr Iterator begin() const {
+        auto s = storage();
+        return Iterator(this, engine_t::first(s, root));
+    }
+
+    constexpr Iterator end() const {
+        return Iterator(this, nil);
+    }
+
+    [[nodiscard]] constexpr size_t size() const {
+        return count;
+    }
+
+    [[nodiscard]] static constexpr size_t capacity() {
+        return N;
+    }
+
+    [[nodiscard]] constexpr bool empty() const {
+        return count == 0;
+    }
+
+    [[nodiscard]] constexpr bool full() const {
+        return count == N;
+    }
+
+    constexpr void clear() {
+        root = free_list = nil;
+        used = count = 0;
+    }
+};
+
+#endif // STATIC_SPLAY_H
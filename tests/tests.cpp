@@ -1,11 +1,28 @@
 #include <iostream>
 #include "../splay.h"
+#include "../splay_mapped.h"
+#include "../splay_block.h"
+#include "../splay_cache.h"
+#include "../splay_trace.h"
+#include "../splay_link_cut.h"
+#include "../splay_euler_tour.h"
+#include "../splay_interval.h"
+#include "../splay_queue.h"
+#include "../splay_string.h"
+#include "../sliding_window.h"
+#include "../static_splay.h"
+#include "../splay_small.h"
 #include <set>
 #include <utility>
 #include <functional>
 #include "assert.h"
 #include <any>
 #include <limits>
+#include <filesystem>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <atomic>
 
 template <typename T>
 bool equals(const std::set<T> &set, const SplayTree<T> &splay) {
@@ -131,6 +148,58 @@ void test_merge_basic() {
     assert(equals({2, 7}, splay2));
 }
 
+void test_node_handle_basic() {
+    SplayTree<int> splay1 = { 5, 1, 8, 3 };
+    SplayTree<int> splay2 = { 2, 8 };
+
+    assert(splay1.extract(4).empty());
+
+    auto node = splay1.extract(5);
+    assert(!node.empty() && node.value() == 5);
+    assert(equals({ 1, 3, 8 }, splay1));
+
+    const int *address = &node.value();
+    auto result = splay2.insert(std::move(node));
+    assert(result.inserted && result.node.empty() && *result.position == 5 && &*result.position == address);
+    assert(equals({ 2, 5, 8 }, splay2));
+
+    node = splay1.extract(splay1.find(8));
+    node.value() = 9;
+    result = splay2.insert(std::move(node));
+    assert(result.inserted && equals({ 2, 5, 8, 9 }, splay2));
+
+    node = splay2.extract(splay2.find(2));
+    result = splay2.insert(std::move(node));
+    assert(result.inserted);
+    node = SplayTree<int>({ 5 }).extract(5);
+    result = splay2.insert(std::move(node));
+    assert(!result.inserted && !result.node.empty() && *result.position == 5);
+    assert(equals({ 2, 5, 8, 9 }, splay2));
+
+    SplayTree<int> sum_tree({ 4, 1, 7 }, { [](int v, int left, int right) { return v + left + right; }, 0 });
+    SplayTree<int> other_sum({ 9, 4 }, { [](int v, int left, int right) { return v + left + right; }, 0 });
+    sum_tree.merge(other_sum);
+    assert(equals({ 1, 4, 7, 9 }, sum_tree) && sum_tree.get_function_value() == 21);
+    assert(equals({ 4 }, other_sum) && other_sum.get_function_value() == 4);
+
+    std::mt19937 gen(38);
+    for (int round = 0; round < 20; round++) {
+        SplayTree<int> a, b;
+        std::set<int> set_a, set_b;
+        for (int i = 0; i < 200; i++) {
+            int x = static_cast<int>(gen() % 300), y = static_cast<int>(gen() % 300);
+            a.insert(x);
+            set_a.insert(x);
+            b.insert(y);
+            set_b.insert(y);
+        }
+        a.merge(b);
+        set_a.merge(set_b);
+        assert(equals(set_a, a) && equals(set_b, b));
+        assert(a.size() == set_a.size() && b.size() == set_b.size());
+    }
+}
+
 void test_find_basic() {
     SplayTree<int> splay = {6, 9, 4, 2, 1};
 
@@ -358,6 +427,1406 @@ void test_comparator_concept() {
     assert(!(Comparator<NotCompPrivateOperator, int>));
 }
 
+void test_set_algebra_basic() {
+    SplayTree<int>::Function sum = { [](int v, int left, int right) { return v + left + right; }, 0 };
+    SplayTree<int> splay1({ 1, 2, 3, 5, 8, 13 }, sum);
+    SplayTree<int> splay2({ 2, 3, 4, 5, 6, 7 }, sum);
+
+    auto united = splay1.set_union(splay2);
+    assert(equals({ 1, 2, 3, 4, 5, 6, 7, 8, 13 }, united));
+    assert(united.get_function_value() == 49);
+
+    auto intersection = splay1.set_intersection(splay2);
+    assert(equals({ 2, 3, 5 }, intersection));
+    assert(intersection.get_function_value() == 10);
+
+    assert(equals({ 1, 8, 13 }, splay1.set_difference(splay2)));
+    assert(equals({ 4, 6, 7 }, splay2.set_difference(splay1)));
+    assert(equals({ 1, 4, 6, 7, 8, 13 }, splay1.symmetric_difference(splay2)));
+
+    assert(equals({ 1, 2, 3, 5, 8, 13 }, splay1));
+    assert(splay1.set_intersection(SplayTree<int>()).empty());
+
+    united.insert(0);
+    united.erase(4);
+    assert(equals({ 0, 1, 2, 3, 5, 6, 7, 8, 13 }, united));
+    assert(united.get_function_value() == 45);
+}
+
+void test_neighbors_basic() {
+    SplayTree<int> splay = {2, 1, 3, 7, 4, 6, 9};
+
+    assert(splay.floor(5) == 4);
+    assert(splay.floor(6) == 6);
+    assert(!splay.floor(0).has_value());
+    assert(splay.ceiling(5) == 6);
+    assert(splay.ceiling(6) == 6);
+    assert(!splay.ceiling(10).has_value());
+    assert(splay.predecessor(6) == 4);
+    assert(!splay.predecessor(1).has_value());
+    assert(splay.successor(6) == 7);
+    assert(splay.successor(8) == 9);
+    assert(!splay.successor(9).has_value());
+
+    assert(!SplayTree<int>().floor(1).has_value());
+
+    auto it = splay.lower_bound(5);
+    std::vector<int> rest;
+    for (; it != splay.end(); it++) {
+        rest.push_back(*it);
+    }
+    assert((rest == std::vector<int>{ 6, 7, 9 }));
+}
+
+void test_range_basic() {
+    SplayTree<int> splay = {2, 1, 3, 7, 4, 6, 9, 12};
+
+    auto range = std::as_const(splay).range(3, 9);
+    static_assert(std::ranges::view<decltype(range)>);
+    static_assert(std::ranges::forward_range<decltype(range)>);
+
+    std::vector<int> values(range.begin(), range.end());
+    assert((values == std::vector<int>{ 3, 4, 6, 7 }));
+
+    auto evens = splay.range(0, 100) | std::views::filter([](int x) { return x % 2 == 0; });
+    values.assign(evens.begin(), evens.end());
+    assert((values == std::vector<int>{ 2, 4, 6, 12 }));
+
+    assert(splay.range(10, 12).empty());
+    assert(splay.range(7, 7).empty());
+    assert(splay.range(13, 20).empty());
+    assert(SplayTree<int>().range(0, 1).empty());
+}
+
+template<class V, class Comp>
+void check_block_tree(unsigned seed) {
+    BlockSplayTree<V, Comp, 16> splay;
+    std::set<V, Comp> set;
+    std::mt19937 gen(seed);
+
+    for (int i = 0; i < 4000; i++) {
+        V x = static_cast<V>(gen() % 1000) - 500;
+        if (gen() % 3 != 0) {
+            assert(splay.insert(x) == set.insert(x).second);
+        }
+        else {
+            assert(splay.erase(x) == (set.erase(x) == 1));
+        }
+    }
+
+    assert(splay.size() == set.size());
+    assert(std::equal(splay.begin(), splay.end(), set.begin(), set.end()));
+    for (int x = -500; x < 500; x++) {
+        assert(std::as_const(splay).contains(static_cast<V>(x)) == set.contains(static_cast<V>(x)));
+        assert(splay.contains(static_cast<V>(x)) == set.contains(static_cast<V>(x)));
+    }
+}
+
+void test_block_basic() {
+    BlockSplayTree<int> splay = { 5, 3, 9, 1 };
+    assert(splay.size() == 4);
+    assert(*splay.begin() == 1);
+    assert(!splay.insert(3));
+
+    check_block_tree<int, std::less<int>>(1);
+    check_block_tree<long long, std::less<>>(2);
+    check_block_tree<int, std::greater<>>(3);
+    check_block_tree<double, std::less<double>>(4);
+}
+
+template<class V, class Comp>
+void check_block_extremes(std::vector<V> values) {
+    BlockSplayTree<V, Comp, 8> splay;
+    std::set<V, Comp> set;
+    for (int i = -20; i < 20; i++) {
+        values.push_back(static_cast<V>(i));
+    }
+    for (const V &x : values) {
+        assert(splay.insert(x) == set.insert(x).second);
+        assert(!splay.insert(x));
+    }
+
+    assert(splay.size() == set.size());
+    assert(std::equal(splay.begin(), splay.end(), set.begin(), set.end()));
+    for (const V &x : set) {
+        assert(splay.contains(x));
+        assert(splay.erase(x));
+        assert(!std::as_const(splay).contains(x));
+    }
+    assert(splay.empty());
+}
+
+void test_block_extremes() {
+    using int_limits = std::numeric_limits<int>;
+    using double_limits = std::numeric_limits<double>;
+    std::vector<int> ints = { int_limits::max(), int_limits::min(), int_limits::max() - 1, int_limits::min() + 1 };
+    std::vector<double> doubles = { double_limits::infinity(), -double_limits::infinity(), double_limits::max(),
+                                    double_limits::lowest() };
+
+    check_block_extremes<int, std::less<>>(ints);
+    check_block_extremes<int, std::greater<>>(ints);
+    check_block_extremes<double, std::less<>>(doubles);
+    check_block_extremes<double, std::greater<>>(doubles);
+
+    BlockSplayTree<double> splay = { 1.0 };
+    assert(!splay.insert(double_limits::quiet_NaN()));
+    assert(!splay.contains(double_limits::quiet_NaN()));
+    assert(splay.insert(double_limits::infinity()) && splay.size() == 2);
+}
+
+void test_parallel_basic() {
+    std::vector<long long> values(100000);
+    std::iota(values.begin(), values.end(), 0);
+
+    using splay_sum_t = SplayTree<long long, std::less<>, long long>;
+    splay_sum_t::Function sum = { [](long long v, long long left, long long right) { return v + left + right; }, 0 };
+
+    auto splay = splay_sum_t::from_sorted(values, sum, 4);
+    assert(splay.size() == values.size());
+    assert(splay.get_function_value() == 99999LL * 100000 / 2);
+    assert(splay.contains(4242) && !splay.contains(-1));
+
+    std::atomic<long long> total = 0;
+    splay.parallel_for_each([&](long long x) { total += x; }, 4);
+    assert(total == 99999LL * 100000 / 2);
+
+    auto ordered = splay.parallel_reduce(std::vector<long long>(),
+            [](std::vector<long long> a, const std::vector<long long> &b) {
+                a.insert(a.end(), b.begin(), b.end());
+                return a;
+            },
+            [](long long x) { return std::vector<long long>{ x }; }, 4);
+    assert(ordered == values);
+
+    splay.set_function({ [](long long v, long long left, long long right) { return std::max({ v, left, right }); }, -1 }, 4);
+    assert(splay.get_function_value() == 99999);
+
+    auto copy = splay;
+    splay.clear(4);
+    assert(splay.empty());
+    assert(copy.size() == values.size() && copy.contains(77));
+}
+
+void test_clear_deep() {
+    SplayTree<int> splay;
+    for (int i = 0; i < 500000; i++) {
+        splay.insert(i);
+    }
+    assert(splay.size() == 500000);
+
+    splay.clear();
+    assert(splay.empty());
+
+    for (int i = 0; i < 500000; i++) {
+        splay.insert(-i);
+    }
+}
+
+template<class Policy>
+void check_splay_policy(unsigned seed) {
+    using splay_t = SplayTree<int, std::less<>, int, Policy>;
+    typename splay_t::Function sum = { [](int v, int left, int right) { return v + left + right; }, 0 };
+    splay_t splay(sum);
+    std::set<int> set;
+    std::mt19937 gen(seed);
+
+    for (int i = 0; i < 3000; i++) {
+        int x = static_cast<int>(gen() % 400);
+        switch (gen() % 5) {
+            case 0:
+                splay.insert(x);
+                set.insert(x);
+                break;
+            case 1:
+                assert(splay.erase(x) == (set.erase(x) == 1));
+                break;
+            case 2:
+                assert(splay.contains(x) == set.contains(x));
+                break;
+            case 3: {
+                auto it = splay.lower_bound(x);
+                auto set_it = set.lower_bound(x);
+                assert(set_it == set.end() ? it == splay.end() : *it == *set_it);
+                break;
+            }
+            default: {
+                auto it = splay.find(x);
+                assert(set.contains(x) ? *it == x : it == splay.end());
+                break;
+            }
+        }
+    }
+
+    assert(splay.size() == set.size());
+    assert(std::equal(set.begin(), set.end(), splay.begin()));
+    assert(splay.get_function_value() == std::accumulate(set.begin(), set.end(), 0));
+}
+
+void test_splay_policies() {
+    check_splay_policy<FullSplay>(1);
+    check_splay_policy<SemiSplay>(2);
+    check_splay_policy<DepthThresholdSplay<4>>(3);
+    check_splay_policy<RandomizedSplay<25>>(4);
+
+    assert(SplayingPolicy<SemiSplay>);
+    assert(!SplayingPolicy<int>);
+}
+
+void test_cache_basic() {
+    SplayCache<int, std::string> cache(3);
+
+    cache.put(1, "one");
+    cache.put(2, "two");
+    cache.put(3, "three");
+    assert(cache.size() == 3);
+
+    assert(cache.get(1) != nullptr && *cache.get(1) == "one");
+    cache.put(4, "four");
+    assert(cache.size() == 3);
+    assert(!cache.contains(2));
+    assert(cache.contains(1) && cache.contains(3) && cache.contains(4));
+
+    assert(cache.get(2) == nullptr);
+    cache.put(3, "THREE");
+    cache.put(5, "five");
+    assert(!cache.contains(1));
+    assert(*cache.get(3) == "THREE");
+
+    assert(cache.statistics().hits == 3);
+    assert(cache.statistics().misses == 1);
+    assert(cache.statistics().evictions == 2);
+
+    assert(cache.erase(4));
+    assert(!cache.erase(4));
+    assert(cache.size() == 2);
+
+    SplayCache<int, std::string> sized(100, 10, [](int, const std::string &value) { return value.size(); });
+    sized.put(1, "aaaa");
+    sized.put(2, "bbbb");
+    sized.get(1);
+    sized.put(3, "cccc");
+    assert(sized.contains(1) && !sized.contains(2) && sized.contains(3));
+    assert(sized.bytes() == 8);
+
+    assert(!sized.put(4, "a value too large for the cache"));
+    assert(sized.size() == 2 && !sized.contains(4) && sized.bytes() == 8);
+    assert(!sized.put(3, "another value too large"));
+    assert(sized.size() == 1 && !sized.contains(3) && sized.bytes() == 4);
+    assert(sized.put(5, "ten chars!") && sized.size() == 1 && sized.bytes() == 10);
+
+    SplayCache<int, int> disabled(0);
+    assert(!disabled.put(1, 1));
+    assert(disabled.empty() && disabled.get(1) == nullptr);
+
+    SplayCache<int, std::shared_ptr<int>> owning(1);
+    auto value = std::make_shared<int>(1);
+    owning.put(1, value);
+    owning.put(2, std::make_shared<int>(2));
+    assert(value.use_count() == 1);
+    owning.erase(2);
+    owning.put(3, value);
+    assert(value.use_count() == 2);
+}
+
+void test_cache_random() {
+    SplayCache<int, int> cache(64);
+    std::vector<int> recency;
+    std::mt19937 gen(5);
+
+    for (int i = 0; i < 20000; i++) {
+        int key = static_cast<int>(gen() % 200);
+        auto it = std::find(recency.begin(), recency.end(), key);
+        bool present = it != recency.end();
+
+        if (gen() % 2 == 0) {
+            int *value = cache.get(key);
+            assert((value != nullptr) == present);
+            if (present) {
+                assert(*value == key * 7);
+                recency.erase(it);
+                recency.push_back(key);
+            }
+        }
+        else {
+            cache.put(key, key * 7);
+            if (present) {
+                recency.erase(it);
+            }
+            recency.push_back(key);
+            if (recency.size() > 64) {
+                recency.erase(recency.begin());
+            }
+        }
+        assert(cache.size() == recency.size());
+    }
+}
+
+void test_trace_basic() {
+    std::stringstream stream;
+    TraceWriter<int> writer(stream);
+
+    SplayTree<int> splay;
+    splay.set_trace_hook(writer.hook());
+    splay.insert(5);
+    splay.insert(3);
+    splay.insert(8);
+    splay.contains(3);
+    splay.erase(5);
+    std::as_const(splay).contains(4);
+    splay.find(8);
+    splay.lower_bound(6);
+    auto less = splay.erase_less(8);
+    assert(splay.rotations() > 0);
+
+    std::vector<std::pair<TraceOperation, int>> expected = {
+            { TraceOperation::insert, 5 },
+            { TraceOperation::insert, 3 },
+            { TraceOperation::insert, 8 },
+            { TraceOperation::contains, 3 },
+            { TraceOperation::erase, 5 },
+            { TraceOperation::contains, 4 },
+            { TraceOperation::find, 8 },
+            { TraceOperation::lower_bound, 6 },
+            { TraceOperation::erase_less, 8 }
+    };
+
+    assert(TraceReader<int>::value_size(stream) == sizeof(int));
+    TraceReader<int> reader(stream);
+    std::vector<std::pair<TraceOperation, int>> recorded;
+    while (auto record = reader.next()) {
+        recorded.push_back(*record);
+    }
+    assert(recorded == expected);
+}
+
+std::vector<int> forest_path(const std::vector<std::set<int>> &adjacency, int from, int to) {
+    std::vector<int> previous(adjacency.size(), -1);
+    std::vector<int> queue = { from };
+    previous[from] = from;
+
+    for (size_t i = 0; i < queue.size(); i++) {
+        for (int next : adjacency[queue[i]]) {
+            if (previous[next] == -1) {
+                previous[next] = queue[i];
+                queue.push_back(next);
+            }
+        }
+    }
+
+    if (previous[to] == -1) {
+        return {};
+    }
+
+    std::vector<int> path = { to };
+    while (path.back() != from) {
+        path.push_back(previous[path.back()]);
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+void test_link_cut_basic() {
+    using link_cut_t = LinkCutTree<int, std::string>;
+    link_cut_t::Function to_str = {
+            [](int v, const std::string &left, const std::string &right) {
+                return left + std::to_string(v) + ";" + right;
+            }, "" };
+
+    const int n = 40;
+    link_cut_t forest(n, 0, to_str);
+    for (int i = 0; i < n; i++) {
+        forest.set_value(i, i);
+    }
+
+    std::vector<std::set<int>> adjacency(n);
+    std::vector<std::pair<int, int>> edges;
+    std::mt19937 gen(11);
+
+    for (int i = 0; i < 3000; i++) {
+        int u = static_cast<int>(gen() % n), v = static_cast<int>(gen() % n);
+        auto path = forest_path(adjacency, u, v);
+
+        switch (gen() % 4) {
+            case 0: {
+                bool linked = forest.link(u, v);
+                assert(linked == path.empty());
+                if (linked) {
+                    adjacency[u].insert(v);
+                    adjacency[v].insert(u);
+                    edges.emplace_back(u, v);
+                }
+                break;
+            }
+            case 1: {
+                if (!edges.empty()) {
+                    size_t index = gen() % edges.size();
+                    auto [a, b] = edges[index];
+                    assert(gen() % 2 ? forest.cut(a, b) : forest.cut(b, a));
+                    adjacency[a].erase(b);
+                    adjacency[b].erase(a);
+                    edges.erase(edges.begin() + static_cast<long>(index));
+                }
+                if (!adjacency[u].contains(v)) {
+                    assert(!forest.cut(u, v));
+                }
+                break;
+            }
+            case 2: {
+                assert(forest.connected(u, v) == !path.empty());
+                auto value = forest.path_function_value(u, v);
+                assert(value.has_value() == !path.empty());
+                if (value) {
+                    std::string expected;
+                    for (int x : path) {
+                        expected += std::to_string(x) + ";";
+                    }
+                    assert(*value == expected);
+                }
+                break;
+            }
+            default: {
+                int root = static_cast<int>(gen() % n);
+                forest.make_root(root);
+                auto lca = forest.lca(u, v);
+                auto to_u = forest_path(adjacency, root, u), to_v = forest_path(adjacency, root, v);
+                if (path.empty() || to_u.empty()) {
+                    assert(!lca.has_value() || !path.empty());
+                    break;
+                }
+                size_t common = 0;
+                while (common < to_u.size() && common < to_v.size() && to_u[common] == to_v[common]) {
+                    common++;
+                }
+                assert(lca.has_value() && static_cast<int>(*lca) == to_u[common - 1]);
+                assert(static_cast<int>(forest.find_root(u)) == root);
+                break;
+            }
+        }
+    }
+}
+
+void test_euler_tour_basic() {
+    const int n = 40;
+    EulerTourTree<long long> forest(n, 0, { std::plus<>(), 0 });
+    for (int i = 0; i < n; i++) {
+        forest.set_value(i, i * i);
+    }
+
+    std::vector<std::set<int>> adjacency(n);
+    std::mt19937 gen(13);
+
+    auto component = [&](int root, int blocked) {
+        std::vector<int> seen(n, 0), queue = { root };
+        seen[root] = 1;
+        if (blocked >= 0) {
+            seen[blocked] = 1;
+        }
+        for (size_t i = 0; i < queue.size(); i++) {
+            for (int next : adjacency[queue[i]]) {
+                if (!seen[next]) {
+                    seen[next] = 1;
+                    queue.push_back(next);
+                }
+            }
+        }
+        return queue;
+    };
+
+    for (int i = 0; i < 4000; i++) {
+        int u = static_cast<int>(gen() % n), v = static_cast<int>(gen() % n);
+        auto reachable = component(u, -1);
+        bool connected = std::find(reachable.begin(), reachable.end(), v) != reachable.end();
+
+        switch (gen() % 4) {
+            case 0:
+                assert(forest.link(u, v) == !connected);
+                if (!connected) {
+                    adjacency[u].insert(v);
+                    adjacency[v].insert(u);
+                }
+                break;
+            case 1:
+                if (adjacency[u].empty()) {
+                    assert(!forest.cut(u, v) || u == v);
+                    break;
+                }
+                v = *adjacency[u].begin();
+                assert(forest.cut(u, v));
+                adjacency[u].erase(v);
+                adjacency[v].erase(u);
+                break;
+            case 2: {
+                assert(forest.connected(u, v) == connected);
+                assert(forest.component_size(u) == reachable.size());
+                long long sum = 0;
+                for (int x : reachable) {
+                    sum += 1LL * x * x;
+                }
+                assert(forest.component_function_value(u) == sum);
+                break;
+            }
+            default: {
+                if (adjacency[u].empty()) {
+                    assert(!forest.subtree(v, u).has_value() || adjacency[v].contains(u));
+                    break;
+                }
+                int child = *adjacency[u].begin();
+                auto below = component(child, u);
+                long long sum = 0;
+                for (int x : below) {
+                    sum += 1LL * x * x;
+                }
+                auto result = forest.subtree(child, u);
+                assert(result.has_value() && result->first == below.size() && result->second == sum);
+                assert(forest.subtree_size(child, u) == below.size());
+                break;
+            }
+        }
+    }
+}
+
+void test_interval_basic() {
+    using interval_t = SplayIntervalTree<int>::Interval;
+
+    SplayIntervalTree<int> intervals;
+    std::set<std::pair<int, int>> naive;
+    std::mt19937 gen(21);
+
+    assert(!intervals.insert(5, 5));
+    assert(intervals.insert(1, 4) && !intervals.insert(1, 4));
+    assert(intervals.stabbing(4).empty() && intervals.stabbing(1).size() == 1);
+    intervals.clear();
+
+    for (int i = 0; i < 3000; i++) {
+        int lo = static_cast<int>(gen() % 1000);
+        int hi = lo + 1 + static_cast<int>(gen() % (i % 7 == 0 ? 300 : 20));
+
+        if (gen() % 3 != 0) {
+            assert(intervals.insert(lo, hi) == naive.emplace(lo, hi).second);
+        }
+        else if (!naive.empty()) {
+            auto it = naive.lower_bound({ lo, 0 });
+            if (it == naive.end()) {
+                it = naive.begin();
+            }
+            assert(intervals.erase(it->first, it->second));
+            naive.erase(it);
+        }
+
+        std::vector<interval_t> expected_overlap, expected_stab;
+        for (auto [a, b] : naive) {
+            if (a < hi && lo < b) {
+                expected_overlap.push_back({ a, b });
+            }
+            if (a <= lo && lo < b) {
+                expected_stab.push_back({ a, b });
+            }
+        }
+        assert(intervals.overlapping(lo, hi) == expected_overlap);
+        assert(intervals.stabbing(lo) == expected_stab);
+        assert(intervals.size() == naive.size());
+    }
+}
+
+struct first_less {
+    bool operator ()(const std::pair<int, int> &a, const std::pair<int, int> &b) const {
+        return a.first < b.first;
+    }
+};
+
+void test_queue_basic() {
+    SplayQueue<std::pair<int, int>, first_less> fifo;
+    for (int i = 0; i < 5; i++) {
+        fifo.push({ i % 2, i });
+    }
+    assert(fifo.pop_min().second == 0 && fifo.pop_min().second == 2 && fifo.pop_max().second == 1);
+
+    SplayQueue<std::pair<int, int>, first_less> equal;
+    for (int i = 0; i < 4; i++) {
+        equal.push({ 7, i });
+    }
+    assert(equal.pop_max().second == 0 && equal.pop_max().second == 1 && equal.pop_min().second == 2);
+
+    SplayQueue<std::pair<int, int>, first_less> left, right;
+    for (int i = 0; i < 3; i++) {
+        left.push({ 1, i });
+        right.push({ 1, i + 3 });
+    }
+    left.push({ 0, -1 });
+    left.push({ 2, -2 });
+    right.push({ 0, -3 });
+    right.push({ 2, -4 });
+    left.meld(right);
+    assert(right.empty() && left.size() == 10);
+    assert(left.pop_max().second == -2 && left.pop_max().second == -4);
+    assert(left.pop_min().second == -1 && left.pop_min().second == -3);
+    for (int i = 0; i < 6; i++) {
+        assert(left.pop_min().second == i);
+    }
+
+    SplayQueue<std::pair<int, int>, first_less> joined, appended;
+    for (int i = 0; i < 3; i++) {
+        joined.push({ 1, i });
+        appended.push({ 1, i + 3 });
+    }
+    joined.meld(appended);
+    assert(joined.pop_max().second == 0 && joined.pop_min().second == 1 && joined.pop_max().second == 2);
+
+    using item_t = std::pair<int, int>;
+
+    SplayQueue<item_t> queue, other;
+    std::set<item_t> naive;
+    std::map<int, SplayQueue<item_t>::handle> handles;
+    std::mt19937 gen(37);
+    int next_id = 0;
+
+    auto pop = [&](item_t item, const item_t &expected) {
+        assert(item == expected);
+        naive.erase(item);
+        handles.erase(item.second);
+    };
+
+    for (int i = 0; i < 20000; i++) {
+        int priority = static_cast<int>(gen() % 1000);
+        switch (gen() % 6) {
+            case 0:
+            case 1:
+                handles[next_id] = queue.push({ priority, next_id });
+                naive.insert({ priority, next_id++ });
+                break;
+            case 2:
+                if (!naive.empty()) {
+                    pop(queue.pop_min(), *naive.begin());
+                }
+                break;
+            case 3:
+                if (!naive.empty()) {
+                    pop(queue.pop_max(), *naive.rbegin());
+                }
+                break;
+            default:
+                if (!handles.empty()) {
+                    auto it = handles.lower_bound(static_cast<int>(gen() % next_id));
+                    auto [id, h] = it == handles.end() ? *handles.begin() : *it;
+                    item_t item = queue.get(h);
+                    assert(item.second == id && naive.contains(item));
+                    if (gen() % 2 == 0) {
+                        pop(queue.cancel(h), item);
+                    }
+                    else {
+                        queue.reschedule(h, { priority, id });
+                        naive.erase(item);
+                        naive.insert({ priority, id });
+                    }
+                }
+        }
+
+        if (i % 2000 == 1999) {
+            int offset = (i / 2000) % 3 == 0 ? 0 : (i / 2000) % 3 == 1 ? 2000 : -2000;
+            for (int j = 0; j < 50; j++) {
+                item_t item = { static_cast<int>(gen() % 500) + offset, next_id++ };
+                handles[item.second] = other.push(item);
+                naive.insert(item);
+            }
+            queue.meld(other);
+            assert(other.empty());
+        }
+
+        assert(queue.size() == naive.size());
+        if (!naive.empty()) {
+            assert(queue.min() == *naive.begin() && queue.max() == *naive.rbegin());
+        }
+    }
+}
+
+void test_statistics_basic() {
+    SplayTree<int> splay;
+    for (int i = 0; i < 100; i++) {
+        splay.insert(i);
+    }
+    assert(splay.hottest(5).empty() && splay.depth_histogram().empty());
+
+    splay.enable_statistics();
+    for (int i = 0; i < 50; i++) {
+        splay.contains(7);
+    }
+    for (int i = 0; i < 30; i++) {
+        splay.contains(42);
+    }
+    for (int i = 0; i < 100; i++) {
+        splay.contains(i);
+    }
+    splay.insert(7);
+
+    auto hottest = splay.hottest(2);
+    assert(hottest.size() == 2);
+    assert(hottest[0] == std::make_pair(7, size_t(52)) && hottest[1] == std::make_pair(42, size_t(31)));
+    assert(splay.hottest(1000).size() == 100);
+    assert(splay.sampled_accesses() == 181);
+
+    auto histogram = splay.depth_histogram();
+    assert(std::accumulate(histogram.begin(), histogram.end(), size_t(0)) == 180);
+    assert(histogram[0] >= 78 && histogram.back() > 0);
+
+    splay.enable_statistics(10);
+    for (int i = 0; i < 1000; i++) {
+        splay.contains(i % 10);
+    }
+    size_t samples = splay.sampled_accesses(), sampled_hot = 0;
+    assert(samples > 50 && samples < 200);
+    for (auto [value, count] : splay.hottest(20)) {
+        assert(value < 10);
+        sampled_hot += count;
+    }
+    assert(sampled_hot == samples && splay.hottest(20).size() > 5);
+
+    splay.disable_statistics();
+    splay.contains(50);
+    assert(splay.sampled_accesses() == 0 && splay.depth_histogram().empty());
+
+    SplayTree<int> erased = { 1, 2, 3, 4, 5, 6 };
+    erased.enable_statistics();
+    for (int i = 0; i < 10; i++) {
+        erased.contains(3);
+    }
+    erased.contains(5);
+    erased.contains(4);
+    erased.erase(4);
+    assert(erased.hottest(2) == (std::vector<std::pair<int, size_t>>{ { 3, 10 }, { 5, 1 } }));
+}
+
+void test_rebalance_basic() {
+    const int n = 1 << 12;
+    SplayTree<int> splay({}, { [](int v, int left, int right) { return v + left + right; }, 0 });
+    for (int i = 0; i < n; i++) {
+        splay.insert(i);
+    }
+
+    size_t rotations = splay.rotations();
+    splay.rebalance();
+    assert(splay.contains(0) && splay.rotations() - rotations <= 12);
+    assert(splay.get_function_value() == n * (n - 1) / 2 && splay.size() == n);
+
+    for (int i = 0; i < n; i++) {
+        splay.contains(i);
+    }
+    splay.set_rebalance(3);
+    rotations = splay.rotations();
+    assert(splay.contains(0) && splay.rebalances() == 2);
+    assert(splay.rotations() - rotations <= 3 * 13);
+
+    for (int i = 0; i < n; i++) {
+        splay.contains(i);
+    }
+    splay.set_rebalance(3, 64);
+    splay.contains(0);
+    assert(splay.rebalances() == 3);
+
+    std::set<int> expected;
+    for (int i = 0; i < n; i++) {
+        expected.insert(i);
+    }
+    assert(equals(expected, splay) && splay.get_function_value() == n * (n - 1) / 2);
+
+    std::mt19937 gen(40);
+    for (int i = 0; i < 5000; i++) {
+        int x = static_cast<int>(gen() % (2 * n));
+        if (gen() % 2 == 0) {
+            splay.erase(x);
+            expected.erase(x);
+        }
+        else {
+            splay.insert(x);
+            expected.insert(x);
+        }
+        int y = static_cast<int>(gen() % (2 * n));
+        assert(splay.contains(y) == expected.contains(y));
+    }
+    assert(equals(expected, splay) && splay.size() == expected.size());
+}
+
+void test_rotation_budget_basic() {
+    const size_t budget = 6;
+    SplayTree<int> splay({}, { [](int v, int left, int right) { return v + left + right; }, 0 });
+    splay.set_rotation_budget(budget);
+
+    std::set<int> expected;
+    std::mt19937 gen(41);
+    for (int i = 0; i < 2000; i++) {
+        size_t rotations = splay.rotations();
+        splay.insert(i);
+        expected.insert(i);
+        assert(splay.rotations() - rotations <= budget);
+    }
+
+    for (int i = 0; i < 20000; i++) {
+        int x = static_cast<int>(gen() % 4000);
+        size_t rotations = splay.rotations();
+        switch (gen() % 4) {
+            case 0:
+                assert(splay.insert(x) != splay.end());
+                assert(splay.rotations() - rotations <= budget);
+                expected.insert(x);
+                rotations = splay.rotations();
+                assert(*splay.find(x) == x);
+                break;
+            case 1:
+                assert(splay.erase(x) == (expected.erase(x) > 0));
+                break;
+            default:
+                assert(splay.contains(x) == expected.contains(x));
+        }
+        assert(splay.rotations() - rotations <= budget);
+    }
+
+    long long sum = std::accumulate(expected.begin(), expected.end(), 0LL);
+    assert(equals(expected, splay) && splay.size() == expected.size() && splay.get_function_value() == sum);
+
+    splay.set_rotation_budget(0);
+    for (int x : expected) {
+        assert(splay.contains(x));
+    }
+    assert(equals(expected, splay) && splay.get_function_value() == sum);
+}
+
+void test_bulk_split_basic() {
+    auto sum = SplayTree<int>::Function([](int v, int left, int right) { return v + left + right; }, 0);
+    std::mt19937 gen(42);
+
+    for (int round = 0; round < 20; round++) {
+        std::set<int> expected;
+        SplayTree<int> splay({}, sum);
+        for (int i = 0; i < 500; i++) {
+            int x = static_cast<int>(gen() % 2000);
+            splay.insert(x);
+            expected.insert(x);
+        }
+
+        int modulus = 2 + round % 5;
+        auto is_multiple = [&](int x) { return x % modulus == 0; };
+
+        assert(erase_if(splay, is_multiple) == std::erase_if(expected, is_multiple));
+        assert(equals(expected, splay) && splay.size() == expected.size());
+        assert(splay.get_function_value() == std::accumulate(expected.begin(), expected.end(), 0));
+
+        auto is_odd = [](int x) { return x % 2 != 0; };
+        auto odd = splay.partition(is_odd);
+        std::set<int> expected_odd;
+        for (int x : expected) {
+            if (is_odd(x)) {
+                expected_odd.insert(x);
+            }
+        }
+        std::erase_if(expected, is_odd);
+        assert(equals(expected, splay) && equals(expected_odd, odd));
+        assert(odd.get_function_value() == std::accumulate(expected_odd.begin(), expected_odd.end(), 0));
+
+        size_t k = gen() % (expected_odd.size() + 2);
+        auto upper = odd.split_at_rank(k);
+        std::set<int> expected_upper;
+        while (expected_odd.size() > k) {
+            expected_upper.insert(*expected_odd.rbegin());
+            expected_odd.erase(std::prev(expected_odd.end()));
+        }
+        assert(equals(expected_odd, odd) && equals(expected_upper, upper));
+        assert(upper.get_function_value() == std::accumulate(expected_upper.begin(), expected_upper.end(), 0));
+        assert(odd.get_function_value() == std::accumulate(expected_odd.begin(), expected_odd.end(), 0));
+    }
+}
+
+void test_string_basic() {
+    StringSplayTree<> strings = { "/api/users", "/api", "/static/app.js", "/api/users/42" };
+    assert(strings.size() == 4 && !strings.insert("/api") && strings.contains("/api/users"));
+    assert(!strings.contains("/api/user") && !strings.contains(""));
+
+    std::vector<std::string> api;
+    for (auto key : strings.prefix_range("/api/")) {
+        api.emplace_back(key);
+    }
+    assert((api == std::vector<std::string> { "/api/users", "/api/users/42" }));
+    assert(strings.prefix_range("/x").empty() && std::ranges::distance(strings.prefix_range("")) == 4);
+
+    std::set<std::string> expected;
+    StringSplayTree<8> tree;
+    std::mt19937 gen(43);
+    const std::vector<std::string> segments = { "/", "a", "ab", "b", "api/", "v1/", "users/", "\xff", "" };
+    auto random_key = [&]() {
+        std::string key;
+        for (size_t i = gen() % 7; i > 0; i--) {
+            key += segments[gen() % segments.size()];
+        }
+        return key;
+    };
+
+    for (int i = 0; i < 20000; i++) {
+        std::string key = random_key();
+        switch (gen() % 4) {
+            case 0:
+            case 1:
+                assert(tree.insert(key) == expected.insert(key).second);
+                break;
+            case 2:
+                assert(tree.erase(key) == (expected.erase(key) > 0));
+                break;
+            default: {
+                assert(tree.contains(key) == expected.contains(key));
+
+                std::vector<std::string> found, wanted;
+                for (auto k : tree.prefix_range(key)) {
+                    found.emplace_back(k);
+                }
+                for (auto it = expected.lower_bound(key); it != expected.end() && it->starts_with(key); it++) {
+                    wanted.push_back(*it);
+                }
+                assert(found == wanted);
+            }
+        }
+        assert(tree.size() == expected.size());
+    }
+    assert(std::ranges::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+}
+
+void test_sliding_window_basic() {
+    using window_t = SlidingWindowTree<int, long long>;
+    window_t::Function sum = { [](int v, long long left, long long right) { return v + left + right; }, 0 };
+    SlidingWindowTree<int, int> maximum(10, { [](int v, int left, int right) { return std::max({ v, left, right }); },
+                                              std::numeric_limits<int>::min() });
+
+    window_t window(100, sum, 500);
+    std::multimap<long long, int> naive;
+    std::mt19937 gen(44);
+    long long now = 0, cutoff = std::numeric_limits<long long>::min();
+
+    for (int i = 0; i < 20000; i++) {
+        if (gen() % 4 == 0) {
+            now += gen() % 20;
+            window.advance(now);
+            cutoff = std::max(cutoff, now - 100);
+            naive.erase(naive.begin(), naive.upper_bound(cutoff));
+        }
+        else {
+            long long time = now - static_cast<long long>(gen() % 120);
+            int value = static_cast<int>(gen() % 1000);
+            assert(window.add(time, value) == (time > cutoff));
+            if (time > cutoff) {
+                naive.emplace(time, value);
+            }
+        }
+
+        long long expected = 0;
+        for (auto [time, value] : naive) {
+            expected += value;
+        }
+        assert(window.size() == naive.size() && window.get_function_value() == expected);
+        assert(window.pending_expired() <= 500 + 120);
+    }
+
+    window.collect();
+    assert(window.pending_expired() == 0);
+
+    maximum.add(1, 5);
+    maximum.add(3, 9);
+    maximum.add(2, 7);
+    maximum.advance(12);
+    assert(maximum.get_function_value() == 9 && maximum.size() == 1);
+    maximum.advance(13);
+    assert(maximum.get_function_value() == std::numeric_limits<int>::min() && maximum.empty());
+    assert(!maximum.add(3, 1) && maximum.add(4, 1));
+}
+
+constexpr StaticSplayTree<int, 16> static_primes() {
+    StaticSplayTree<int, 16> primes;
+    for (int n = 2; n < 40 && !primes.full(); n++) {
+        bool prime = true;
+        for (int p : primes) {
+            prime = prime && n % p != 0;
+        }
+        if (prime) {
+            primes.insert(n);
+        }
+    }
+    primes.erase(2);
+    primes.insert(1);
+    return primes;
+}
+
+constexpr int static_sum(const StaticSplayTree<int, 16> &tree) {
+    int sum = 0;
+    for (int x : tree) {
+        sum += x;
+    }
+    return sum;
+}
+
+static_assert(static_primes().size() == 12 && static_primes().contains(37) && !static_primes().contains(2));
+static_assert(static_sum(static_primes()) == 1 + 3 + 5 + 7 + 11 + 13 + 17 + 19 + 23 + 29 + 31 + 37);
+
+void test_static_basic() {
+    StaticSplayTree<int, 200> tree;
+    std::set<int> expected;
+    std::mt19937 gen(45);
+
+    for (int i = 0; i < 20000; i++) {
+        int x = static_cast<int>(gen() % 300);
+        switch (gen() % 3) {
+            case 0:
+                if (!tree.full() || tree.contains(x)) {
+                    assert(tree.insert(x) == expected.insert(x).second);
+                }
+                else {
+                    bool thrown = false;
+                    try {
+                        tree.insert(x);
+                    } catch (const std::length_error &) {
+                        thrown = true;
+                    }
+                    assert(thrown);
+                }
+                break;
+            case 1:
+                assert(tree.erase(x) == (expected.erase(x) > 0));
+                break;
+            default:
+                assert(tree.contains(x) == expected.contains(x));
+        }
+        assert(tree.size() == expected.size());
+    }
+    assert(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+
+    StaticSplayTree<std::string, 4, std::greater<>> words = { "b", "a", "c" };
+    assert(*words.begin() == "c" && words.size() == 3);
+    words.clear();
+    assert(words.empty() && words.begin() == words.end());
+}
+
+void test_small_basic() {
+    using small_t = SmallSplayTree<int, std::less<int>, long long, 8>;
+    small_t::Function sum = { [](int v, long long left, long long right) { return v + left + right; }, 0 };
+    small_t tree(sum);
+    std::set<int> expected;
+    std::mt19937 gen(46);
+    int conversions = 0;
+
+    for (int i = 0; i < 20000; i++) {
+        int x = static_cast<int>(gen() % 24);
+        bool small = tree.is_small();
+        switch (gen() % 3) {
+            case 0:
+                assert(tree.insert(x) == expected.insert(x).second);
+                break;
+            case 1:
+                assert(tree.erase(x) == (expected.erase(x) > 0));
+                break;
+            default:
+                assert(tree.contains(x) == expected.contains(x));
+        }
+        conversions += small != tree.is_small();
+
+        assert(tree.size() == expected.size());
+        assert(tree.is_small() || tree.size() > 4);
+        assert(tree.get_function_value() == std::accumulate(expected.begin(), expected.end(), 0LL));
+    }
+    assert(conversions > 0);
+    assert(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+
+    SmallSplayTree<int, std::greater<int>, int, 4> words = { 1, 2, 3, 4, 5 };
+    assert(!words.is_small() && *words.begin() == 5);
+    words.erase(5);
+    words.erase(4);
+    words.erase(3);
+    assert(words.is_small() && *words.begin() == 2 && std::next(words.begin()) != words.end());
+    words.clear();
+    assert(words.empty() && words.begin() == words.end());
+}
+
+void test_reshape_basic() {
+    auto sum = SplayTree<int>::Function([](int v, int left, int right) { return v + left + right; }, 0);
+    std::vector<int> values(1000);
+    std::iota(values.begin(), values.end(), 0);
+    auto tree = SplayTree<int>::from_sorted(values, sum);
+
+    tree.reshape([](int v) { return 1.0 / ((v + 1) * (v + 1)); }, 0.5);
+    assert(tree.frozen() && tree.size() == 1000 && tree.get_function_value() == 999 * 1000 / 2);
+    int expected = 0;
+    for (auto it = tree.begin(); it != tree.end(); it++) {
+        assert(*it == expected++);
+    }
+
+    tree.enable_statistics();
+    size_t rotations = tree.rotations();
+    std::mt19937 gen(47);
+    for (int i = 0; i < 2000; i++) {
+        assert(tree.contains(static_cast<int>(gen() % 8)));
+    }
+    assert(tree.frozen() && tree.rotations() == rotations);
+    assert(tree.depth_histogram().size() <= 8);
+
+    for (int i = 0; i < 2000 && tree.frozen(); i++) {
+        assert(tree.contains(900 + static_cast<int>(gen() % 100)));
+    }
+    assert(!tree.frozen() && tree.rotations() > rotations);
+
+    tree.reset_statistics();
+    for (int i = 0; i < 3000; i++) {
+        tree.contains(i % 3 == 0 ? 500 : static_cast<int>(gen() % 1000));
+    }
+    tree.reshape(0.5);
+    tree.reset_statistics();
+    assert(tree.contains(500));
+    assert(tree.frozen() && tree.depth_histogram() == std::vector<size_t>{ 1 });
+    assert(tree.get_function_value() == 999 * 1000 / 2);
+
+    tree.insert(1000);
+    assert(tree.get_function_value() == 1000 * 1001 / 2 && *tree.rbegin() == 1000);
+    tree.thaw();
+    assert(!tree.frozen());
+
+    SplayTree<int> empty;
+    empty.reshape(0.5);
+    assert(empty.empty() && !empty.frozen());
+}
+
+void test_batch_lookup_basic() {
+    SplayTree<int> tree;
+    std::set<int> expected;
+    std::mt19937 gen(48);
+    for (int i = 0; i < 3000; i++) {
+        int x = static_cast<int>(gen() % 10000);
+        tree.insert(x);
+        expected.insert(x);
+    }
+
+    std::vector<int> probes(5000);
+    for (auto &x : probes) {
+        x = static_cast<int>(gen() % 10000);
+    }
+    size_t rotations = tree.rotations();
+    auto found = std::as_const(tree).contains_many(probes);
+    auto iterators = std::as_const(tree).find_many(probes);
+    assert(tree.rotations() == rotations);
+    assert(found.size() == probes.size() && iterators.size() == probes.size());
+    for (size_t i = 0; i < probes.size(); i++) {
+        assert(found[i] == expected.contains(probes[i]));
+        assert(found[i] ? *iterators[i] == probes[i] : iterators[i] == tree.end());
+    }
+
+    auto it = tree.find_many({ *expected.begin() })[0];
+    assert(*++it == *std::next(expected.begin()));
+    assert(SplayTree<int>().contains_many({ 1, 2 }) == std::vector<bool>(2, false));
+    assert(tree.contains_many({}).empty());
+}
+
+struct CountingLess : std::less<> {
+    size_t *count = nullptr;
+
+    explicit CountingLess(size_t *count = nullptr) : count(count) {}
+
+
+    bool operator ()(const std::string &value1, const std::string &value2) const {
+        ++*count;
+        return value1 < value2;
+    }
+};
+
+struct DirectedLess {
+    bool reverse = false;
+
+    bool operator ()(int value1, int value2) const {
+        return reverse ? value2 < value1 : value1 < value2;
+    }
+};
+
+void test_abbreviated_basic() {
+    size_t plain_count = 0, abbreviated_count = 0;
+    SplayTree<std::string, CountingLess> plain { CountingLess(&plain_count) };
+    SplayTree<std::string, CountingLess, int, FullSplay, StringPrefixKey> abbreviated { CountingLess(&abbreviated_count) };
+    std::set<std::string> expected;
+    std::mt19937 gen(49);
+
+    auto random_string = [&]() {
+        std::string result = gen() % 4 == 0 ? "prefix00" : "";
+        for (size_t length = gen() % 12; length > 0; length--) {
+            result += static_cast<char>('a' + gen() % 26);
+        }
+        return result;
+    };
+
+    for (int i = 0; i < 20000; i++) {
+        auto x = random_string();
+        switch (gen() % 4) {
+            case 0:
+                expected.insert(x);
+                plain.insert(x);
+                abbreviated.insert(x);
+                break;
+            case 1:
+                assert(abbreviated.erase(x) == (expected.erase(x) > 0));
+                plain.erase(x);
+                break;
+            case 2:
+                assert(abbreviated.lower_bound(x) == abbreviated.end() ? expected.lower_bound(x) == expected.end()
+                                                                       : *abbreviated.lower_bound(x) == *expected.lower_bound(x));
+                break;
+            default:
+                assert(abbreviated.contains(x) == expected.contains(x));
+                assert(std::as_const(abbreviated).contains(x) == expected.contains(x));
+                plain.contains(x);
+        }
+        assert(abbreviated.size() == expected.size());
+    }
+    auto it = expected.begin();
+    for (auto &value : abbreviated) {
+        assert(value == *it++);
+    }
+    assert(abbreviated_count * 2 < plain_count);
+
+    std::vector<std::string> probes = { "prefix00", "", *expected.begin(), *expected.rbegin() + "a" };
+    assert((abbreviated.contains_many(probes) == std::vector<bool> { expected.contains("prefix00"), false, true, false }));
+
+    auto sum = SplayTree<int, DirectedLess>::Function([](int v, int left, int right) { return v + left + right; }, 0);
+    SplayTree<int, DirectedLess> reversed(DirectedLess { true }, sum);
+    for (int i = 0; i < 100; i++) {
+        reversed.insert(i);
+    }
+    assert(*reversed.begin() == 99 && reversed.get_function_value() == 99 * 100 / 2);
+
+    auto greater = reversed.erase_less(50);
+    assert(greater.size() == 49 && *greater.begin() == 99 && greater.key_comp().reverse);
+    assert(greater.contains(75) && !greater.contains(25) && *reversed.begin() == 50);
+    greater.insert(120);
+    assert(*greater.begin() == 120);
+
+    SplayTree<int, DirectedLess> unaggregated;
+    unaggregated.insert(1);
+    unaggregated.swap(reversed);
+    assert(unaggregated.get_function_value() == 50 * 51 / 2 && unaggregated.key_comp().reverse);
+    assert(!reversed.key_comp().reverse && reversed.contains(1));
+
+    auto copy = unaggregated;
+    assert(copy.key_comp().reverse && copy.contains(10));
+
+    auto built = SplayTree<int, DirectedLess>::from_sorted({ 3, 2, 1 }, sum, 1, DirectedLess { true });
+    assert(built.contains(2) && *built.begin() == 3 && built.key_comp().reverse);
+
+    SmallSplayTree<int, DirectedLess, int, 4> small(DirectedLess { true });
+    for (int i = 0; i < 10; i++) {
+        small.insert(i);
+    }
+    assert(!small.is_small() && *small.begin() == 9 && small.contains(5));
+    for (int i = 0; i < 8; i++) {
+        small.erase(i);
+    }
+    assert(small.is_small() && *small.begin() == 9 && small.contains(8) && !small.contains(0));
+}
+
+void test_find_by_aggregate_basic() {
+    auto weight = [](int v) { return static_cast<long long>(v % 5); };
+    SplayTree<int, std::less<int>, long long>::Function sum = {
+            [&](int v, long long left, long long right) { return weight(v) + left + right; }, 0 };
+    SplayTree<int, std::less<int>, long long> tree(sum);
+    std::vector<int> keys;
+    std::mt19937 gen(50);
+    for (int i = 0; i < 200; i++) {
+        int x = static_cast<int>(gen() % 1000);
+        tree.insert(x);
+        keys.push_back(x);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    long long total = tree.get_function_value();
+
+    auto weighted_position = [&](long long x) {
+        long long prefix = 0;
+        for (int key : keys) {
+            prefix += weight(key);
+            if (prefix > x) {
+                return key;
+            }
+        }
+        return -1;
+    };
+
+    for (long long x = 0; x < total; x++) {
+        auto it = tree.find_by_aggregate([x](long long w) { return w > x; }, std::plus<>());
+        assert(it != tree.end() && *it == weighted_position(x) && weight(*it) > 0);
+    }
+    assert(tree.find_by_aggregate([total](long long w) { return w > total; }, std::plus<>()) == tree.end());
+    assert(tree.get_function_value() == total && tree.size() == keys.size());
+
+    auto median = tree.find_by_aggregate([total](long long w) { return 2 * w >= total; }, std::plus<>());
+    assert(*median == weighted_position((total - 1) / 2));
+    assert(*tree.find_by_aggregate([](long long) { return true; }, std::plus<>()) == keys.front());
+
+    std::map<int, int> samples;
+    std::uniform_int_distribution<long long> position(0, total - 1);
+    for (int i = 0; i < 20000; i++) {
+        samples[*tree.find_by_aggregate([x = position(gen)](long long w) { return w > x; }, std::plus<>())]++;
+    }
+    for (auto [key, count] : samples) {
+        assert(std::abs(count - 20000.0 * weight(key) / total) < 0.3 * 20000.0 * weight(key) / total + 20);
+    }
+
+    SplayTree<int, std::less<int>, long long> empty(sum);
+    assert(empty.find_by_aggregate([](long long) { return true; }, std::plus<>()) == empty.end());
+}
+
+void test_mapped_basic() {
+    auto path = std::filesystem::temp_directory_path() / "splay_mapped_test.bin";
+    std::filesystem::remove(path);
+
+    using mapped_sum_t = MappedSplayTree<int, std::less<>, long long>;
+    mapped_sum_t::Function sum = { [](int v, long long left, long long right) { return v + left + right; }, 0 };
+
+    std::set<int> set;
+    std::mt19937 gen(7);
+    {
+        mapped_sum_t splay(path.string());
+        assert(splay.empty());
+
+        for (int i = 0; i < 1000; i++) {
+            int x = static_cast<int>(gen() % 500);
+            assert(splay.insert(x) == set.insert(x).second);
+        }
+        for (int i = 0; i < 300; i++) {
+            int x = static_cast<int>(gen() % 500);
+            assert(splay.erase(x) == (set.erase(x) == 1));
+        }
+        splay.sync();
+    }
+
+    {
+        mapped_sum_t splay(path.string(), sum, 1);
+
+        assert(splay.size() == set.size());
+        assert(std::equal(splay.begin(), splay.end(), set.begin(), set.end()));
+        for (int x = 0; x < 500; x++) {
+            assert(splay.contains(x) == set.contains(x));
+        }
+
+        splay.insert(1000);
+        set.insert(1000);
+        auto it = splay.find(1000);
+        assert(it != splay.end() && *it == 1000);
+        assert(splay.get_function_value() == std::accumulate(set.begin(), set.end(), 0LL));
+    }
+
+    mapped_sum_t::Function count = { [](int, long long left, long long right) { return 1 + left + right; }, 0 };
+    {
+        mapped_sum_t splay(path.string(), count, 2);
+        assert(splay.get_function_value() == static_cast<long long>(set.size()));
+    }
+    {
+        mapped_sum_t splay(path.string(), count, 2);
+        assert(splay.get_function_value() == static_cast<long long>(set.size()));
+    }
+    {
+        mapped_sum_t splay(path.string(), sum, 1);
+        assert(splay.get_function_value() == std::accumulate(set.begin(), set.end(), 0LL));
+    }
+
+    std::filesystem::remove(path);
+}
+
 class Test {
     const std::function<void()> test;
     std::string name;
@@ -383,6 +1852,7 @@ int main() {
             Test(test_correctness_basic, "correctness basic"),
             Test(test_split_basic, "split basic"),
             Test(test_merge_basic, "merge basic"),
+            Test(test_node_handle_basic, "node handle basic"),
             Test(test_find_basic, "find basic"),
             Test(test_swap_basic, "swap basic"),
             Test(test_contains_basic, "contains basic"),
@@ -391,7 +1861,35 @@ int main() {
             Test(test_comparator_basic, "comparator basic"),
             Test(test_insert_iterator, "insert iterator"),
             Test(test_erase_iterator, "erase iterator"),
-            Test(test_comparator_concept, "comparator concept")
+            Test(test_comparator_concept, "comparator concept"),
+            Test(test_mapped_basic, "mapped basic"),
+            Test(test_set_algebra_basic, "set algebra basic"),
+            Test(test_neighbors_basic, "neighbors basic"),
+            Test(test_range_basic, "range basic"),
+            Test(test_block_basic, "block basic"),
+            Test(test_block_extremes, "block extremes"),
+            Test(test_parallel_basic, "parallel basic"),
+            Test(test_clear_deep, "clear deep"),
+            Test(test_splay_policies, "splay policies"),
+            Test(test_cache_basic, "cache basic"),
+            Test(test_cache_random, "cache random"),
+            Test(test_trace_basic, "trace basic"),
+            Test(test_link_cut_basic, "link-cut basic"),
+            Test(test_euler_tour_basic, "euler tour basic"),
+            Test(test_interval_basic, "interval basic"),
+            Test(test_queue_basic, "queue basic"),
+            Test(test_statistics_basic, "statistics basic"),
+            Test(test_rebalance_basic, "rebalance basic"),
+            Test(test_rotation_budget_basic, "rotation budget basic"),
+            Test(test_bulk_split_basic, "bulk split basic"),
+            Test(test_string_basic, "string basic"),
+            Test(test_sliding_window_basic, "sliding window basic"),
+            Test(test_static_basic, "static basic"),
+            Test(test_small_basic, "small basic"),
+            Test(test_reshape_basic, "reshape basic"),
+            Test(test_batch_lookup_basic, "batch lookup basic"),
+            Test(test_abbreviated_basic, "abbreviated basic"),
+            Test(test_find_by_aggregate_basic, "find by aggregate basic")
     };
 
     for (auto test : tests) {